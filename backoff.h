@@ -0,0 +1,111 @@
+/**
+ * @file backoff.h
+ * @author Sihan Zhuang (sihanzhu)
+ * @brief This file contains the contention backoff policies of the lock-free
+ * lists. When many threads CAS the same next pointer, all but one fail and
+ * retry straight away, mostly to fail again while the cache line bounces
+ * between them. Waiting a little after a failure lets the winner finish.
+ * @note An operation creates one policy object and calls pause() after each
+ * failed CAS, so the wait grows with the failures of that operation only.
+ */
+
+#ifndef BACKOFF_H
+#define BACKOFF_H
+
+#include <cstdint>
+#include <functional>
+#include <thread>
+using namespace std;
+
+/**
+ * @brief Tell the CPU that the thread is spinning, which frees the pipeline
+ * for the SMT sibling and saves power
+ */
+inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+  asm volatile("yield" ::: "memory");
+#endif
+}
+
+enum BackoffPolicy {
+  BACKOFF_NONE,
+  BACKOFF_EXPONENTIAL,
+  BACKOFF_RANDOMIZED,
+  NUM_BACKOFF_POLICIES
+};
+
+/**
+ * @brief Per-thread random number generator (xorshift32), seeded from the
+ * thread ID
+ */
+inline uint32_t thread_random() {
+  static thread_local uint32_t state = 0;
+  if (state == 0) {
+    state = static_cast<uint32_t>(hash<thread::id>()(this_thread::get_id()));
+    state |= 1;
+  }
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state;
+}
+
+/**
+ * @brief Retry straight away
+ */
+class NoBackoff {
+public:
+  void pause() {}
+};
+
+/**
+ * @brief Spin for twice as long after every failure. Past MAX_SPINS, yield
+ * instead, in case the thread everyone waits for isn't running
+ */
+class ExponentialBackoff {
+private:
+  static constexpr int MIN_SPINS = 4;
+  static constexpr int MAX_SPINS = 1024;
+  int spins = MIN_SPINS;
+
+public:
+  void pause() {
+    if (spins > MAX_SPINS) {
+      this_thread::yield();
+      return;
+    }
+    for (int i = 0; i < spins; ++i) {
+      cpu_relax();
+    }
+    spins *= 2;
+  }
+};
+
+/**
+ * @brief Spin for a random time, up to a limit proportional to the number of
+ * failures. Threads that failed together don't retry together, which a fixed
+ * schedule makes them do
+ */
+class RandomizedBackoff {
+private:
+  static constexpr int SPINS_PER_FAILURE = 16;
+  static constexpr int MAX_SPINS = 1024;
+  int failures = 0;
+
+public:
+  void pause() {
+    failures++;
+    int limit = failures * SPINS_PER_FAILURE;
+    if (limit > MAX_SPINS) {
+      limit = MAX_SPINS;
+    }
+    int spins = 1 + static_cast<int>(thread_random() % limit);
+    for (int i = 0; i < spins; ++i) {
+      cpu_relax();
+    }
+  }
+};
+
+#endif // BACKOFF_H
@@ -1,255 +1,951 @@
+/**
+ * @file benchmark.cpp
+ * @author Sihan Zhuang (sihanzhu)
+ * @brief Throughput benchmark for the concurrent sets. Each run prefills a
+ * fresh set, releases all the worker threads at once, and lets them run a
+ * random mix of find/insert/remove over a key range for a fixed time. The
+ * keys are uniform by default, see key_distribution.h for the skewed ones.
+ *
+ * Usage: ./bench [--duration=SECONDS] [--threads=1,2,4,...]
+ *                [--mix=FIND,INSERT,REMOVE] [--keys=RANGE] [--prefill=SIZE]
+ *                [--structures=NAME,...] [--output=FILE]
+ *                [--latency=on|off] [--pin=POLICY] [--oversubscribe=on|off]
+ *                [--first-touch=on|off] [--backoff=POLICY]
+ *                [--finger=on|off] [--repeat=N] [--format=FORMAT]
+ *                [--distribution=NAME] [--skew=THETA] [--hot=KEYS,OPS]
+ *                [--hot-shift=MS] [--pop=MODE]
+ */
+
+#include "backoff.h"
+#include "benchmark_report.h"
 #include "coarse_grain_list.h"
+#include "cpu_topology.h"
+#include "flat_combining_list.h"
+#include "key_distribution.h"
+#include "latency_histogram.h"
+#include "lazy_list.h"
 #include "lock_free_list.h"
 #include "lock_free_list_no_reclaim.h"
-#include <thread>
-#include <vector>
+#include "lock_free_skip_list.h"
+#include "lock_free_unrolled_list.h"
+#include "split_ordered_set.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
 #include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <set>
 #include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
 
-std::ofstream result_file("benchmark_results.txt");
-
-void log_result(const std::string &test_type, int threads, int duration) {
-  if (result_file.is_open()) {
-    result_file << test_type << "," << threads << "," << duration << "\n";
+static const char *BACKOFF_NAMES[NUM_BACKOFF_POLICIES] = {
+    "none", "exponential", "randomized"};
+
+static const char *KEY_DISTRIBUTION_NAMES[NUM_KEY_DISTRIBUTIONS] = {
+    "uniform", "zipfian", "hotspot", "ryw"};
+
+/* what a remove operation does, see --pop */
+enum PopMode { POP_OFF, POP_MIN, POP_SPRAY, NUM_POP_MODES };
+
+static const char *POP_NAMES[NUM_POP_MODES] = {"off", "min", "spray"};
+
+static const char *PIN_NAMES[] = {"none", "compact", "scatter", "smt-last"};
+
+/**
+ * @brief Parameters of a benchmark run, set from the command line
+ */
+struct BenchConfig {
+  double duration = 1.0;
+  std::vector<int> threads;
+  int find_percent = 90;
+  int insert_percent = 5;
+  int remove_percent = 5;
+  long key_range = 1024;
+  /* number of keys inserted before the run, half of the key range by default
+   * so that inserts and removes succeed about as often as they fail */
+  long prefill = -1;
+  /* which keys the operations go to, the prefill is always uniform */
+  KeyDistribution distribution = KEYS_UNIFORM;
+  double skew = 0.99;
+  int hot_keys_percent = 10;
+  int hot_ops_percent = 90;
+  /* the hot set moves by its own size every hot_shift_ms, 0 to keep it in
+   * place */
+  long hot_shift_ms = 0;
+  std::vector<std::string> structures;
+  std::string output = "benchmark_results.txt";
+  ReportFormat format = REPORT_TEXT;
+  /* runs per structure and thread count, the results file gets the median */
+  int repetitions = 1;
+  /* time every operation, which costs two clock reads per operation */
+  bool latency = true;
+  PinPolicy pin = PIN_NONE;
+  /* allow more threads than the process has hardware threads */
+  bool oversubscribe = false;
+  /* prefill from the (pinned) workers instead of the main thread, so that
+   * each node is first touched, and placed, on the NUMA node of a worker */
+  bool first_touch = false;
+  std::vector<CpuInfo> topology;
+  /* hardware thread of each worker when pinning, see pinning_order() */
+  std::vector<int> cpu_order;
+  /* what LockFreeList does after a failed CAS, see backoff.h */
+  BackoffPolicy backoff = BACKOFF_NONE;
+  /* start operations from the thread's last position, see finger.h */
+  bool finger = false;
+  /* removes pop the smallest key, or one of the first keys, instead of
+   * removing a random one, which makes the set a priority queue */
+  PopMode pop = POP_OFF;
+
+  /**
+   * @brief Short description of the workload, used to label the results
+   */
+  std::string workload() const {
+    std::ostringstream name;
+    name << "f" << find_percent << "-i" << insert_percent << "-r"
+         << remove_percent << "-k" << key_range << "-p" << prefill;
+    if (distribution == KEYS_ZIPFIAN) {
+      name << "-zipf" << skew;
+    } else if (distribution == KEYS_HOTSPOT) {
+      name << "-hot" << hot_keys_percent << "x" << hot_ops_percent;
+      if (hot_shift_ms > 0) {
+        name << "-shift" << hot_shift_ms;
+      }
+    } else if (distribution == KEYS_READ_YOUR_WRITES) {
+      name << "-ryw";
+    }
+    if (backoff != BACKOFF_NONE) {
+      name << "-" << BACKOFF_NAMES[backoff];
+    }
+    if (finger) {
+      name << "-finger";
+    }
+    if (pop != POP_OFF) {
+      name << "-pop" << POP_NAMES[pop];
+    }
+    return name.str();
+  }
+};
+
+enum Operation { FIND, INSERT, REMOVE, NUM_OPERATIONS };
+
+static const char *OPERATION_NAMES[NUM_OPERATIONS] = {"find", "insert",
+                                                      "remove"};
+
+/**
+ * @brief Result of one worker thread, padded so that the workers don't share
+ * cache lines while counting
+ */
+struct alignas(CACHE_LINE_SIZE) WorkerResult {
+  long ops = 0;
+  /* latency of each operation type in nanoseconds */
+  LatencyHistogram latency[NUM_OPERATIONS];
+};
+
+/**
+ * @brief Start barrier and stop flag shared by the workers of a run
+ */
+struct RunControl {
+  /* keys the workers still have to insert with --first-touch */
+  atomic<long> prefill_left{0};
+  /* first key of the hot set of KEYS_HOTSPOT */
+  atomic<long> hot_start{0};
+  /* keys at the front pop_min_relaxed() picks from, with --pop=spray */
+  unsigned spray_width = 1;
+  atomic<int> ready{0};
+  atomic<bool> start{false};
+  atomic<bool> stop{false};
+};
+
+/**
+ * @brief Remove a key, or pop one from the front for the sets that have
+ * pop_min() when a pop mode is set
+ */
+template <typename SetType>
+auto remove_or_pop(SetType &set, int key, PopMode pop, unsigned spray_width,
+                   int) -> decltype(set.pop_min(key), bool()) {
+  if (pop == POP_MIN) {
+    return set.pop_min(key);
   }
+  if (pop == POP_SPRAY) {
+    return set.pop_min_relaxed(key, spray_width);
+  }
+  return set.remove(key);
 }
 
-static const int NUM_OPERATIONS = 150;
-static const int MAX_THREADS = 256;
+template <typename SetType>
+bool remove_or_pop(SetType &set, int key, PopMode, unsigned, long) {
+  return set.remove(key);
+}
 
-void coarse_grain_mixed_worker_all_delete(CoarseGrainList<int> &list,
-                                          int thread_id) {
-  int base = thread_id * NUM_OPERATIONS;
-  for (int i = 0; i < NUM_OPERATIONS; ++i) {
-    if (i % 2 == 0) {
-      list.insert(base + i);
-    } else {
-      for (int attempt = 0; attempt < 5; ++attempt) {
-        if (list.remove(base + i - 1))
-          break;
-        this_thread::sleep_for(chrono::milliseconds(1 << attempt));
-      }
+/**
+ * @brief Whether the set has the priority queue operations
+ */
+template <typename SetType>
+constexpr auto has_pop_min(int)
+    -> decltype(std::declval<SetType &>().pop_min(std::declval<int &>()),
+                bool()) {
+  return true;
+}
+
+template <typename SetType> constexpr bool has_pop_min(long) { return false; }
+
+/**
+ * @brief Worker thread: pin itself and take its share of the prefill if asked
+ * to, wait for the start signal, then run random operations until the stop
+ * signal
+ *
+ * @param set Set object
+ * @param config Benchmark parameters
+ * @param keys Distribution of the keys of the operations
+ * @param thread_id Thread ID, used as the random seed
+ * @param control Start barrier and stop flag
+ * @param result Number of operations done and their latencies
+ */
+template <typename SetType>
+void worker(SetType &set, const BenchConfig &config, const KeySpace &keys,
+            int thread_id, RunControl &control, WorkerResult &result) {
+  FastRandom rng(thread_id + 1);
+  KeyGenerator generator(keys, thread_id + 1, &control.hot_start);
+  const uint64_t find_limit = config.find_percent;
+  const uint64_t insert_limit = config.find_percent + config.insert_percent;
+  long ops = 0;
+
+  if (config.pin != PIN_NONE) {
+    pin_this_thread(config.cpu_order[thread_id % config.cpu_order.size()]);
+  }
+  // every key reserved is inserted by exactly one worker
+  while (control.prefill_left.fetch_sub(1) > 0) {
+    while (!set.insert(static_cast<int>(rng.next() % config.key_range))) {
     }
   }
-}
 
-void coarse_grain_insert_worker(CoarseGrainList<int> &list, int start) {
-  for (int i = start; i < NUM_OPERATIONS; ++i) {
-    list.insert(i);
+  control.ready++;
+  while (!control.start.load()) {
+    this_thread::yield();
+  }
+
+  while (!control.stop.load(memory_order_relaxed)) {
+    uint64_t choice = generator.next_random() % 100;
+    Operation op = choice < find_limit     ? FIND
+                   : choice < insert_limit ? INSERT
+                                           : REMOVE;
+    int key = static_cast<int>(generator.next(op != FIND));
+
+    std::chrono::steady_clock::time_point op_start;
+    if (config.latency) {
+      op_start = std::chrono::steady_clock::now();
+    }
+    if (op == FIND) {
+      set.find(key);
+    } else if (op == INSERT) {
+      set.insert(key);
+    } else {
+      remove_or_pop(set, key, config.pop, control.spray_width, 0);
+    }
+    if (config.latency) {
+      auto elapsed = std::chrono::steady_clock::now() - op_start;
+      result.latency[op].record(
+          std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed)
+              .count());
+    }
+    ops++;
   }
+  result.ops = ops;
 }
 
-void benchmark_coarse_grain() {
-  std::cout << "Benchmarking CoarseGrainList insert only\n";
+/**
+ * @brief Measurements of one run
+ */
+struct RunResult {
+  double ops_per_sec;
+  double allocs_per_op;
+  /* latencies of all the workers merged, per operation type */
+  LatencyHistogram latency[NUM_OPERATIONS];
+  /* contention counters of the run, for the structures that have them */
+  bool has_stats = false;
+  ListStats stats;
+};
+
+/**
+ * @brief Read the contention counters of a set that has a stats() snapshot
+ *
+ * @return true If the set has counters and they were compiled in
+ */
+template <typename SetType>
+auto read_stats(SetType &set, ListStats &stats, int)
+    -> decltype(set.stats(), true) {
+  stats = set.stats();
+  return StatCounters::enabled;
+}
 
-  for (int num_threads = 1; num_threads <= MAX_THREADS; num_threads *= 2) {
-    CoarseGrainList<int> list;
+template <typename SetType> bool read_stats(SetType &, ListStats &, long) {
+  return false;
+}
 
-    auto start_time = std::chrono::high_resolution_clock::now();
+/**
+ * @brief Turn the search finger of a set on or off, if it has one
+ */
+template <typename SetType>
+auto set_finger(SetType &set, bool enabled, int)
+    -> decltype(set.enable_finger(enabled), void()) {
+  set.enable_finger(enabled);
+}
 
-    std::vector<std::thread> threads;
-    for (int i = 0; i < num_threads; ++i) {
-      threads.emplace_back(coarse_grain_insert_worker, std::ref(list), i);
-    }
+template <typename SetType> void set_finger(SetType &, bool, long) {}
+
+/**
+ * @brief Counters accumulated between two snapshots. The number of retired
+ * nodes still waiting to be freed is a level, so it's taken from the later
+ * one
+ */
+ListStats stats_between(const ListStats &before, const ListStats &after) {
+  ListStats delta = after;
+  delta.operations -= before.operations;
+  delta.search_restarts -= before.search_restarts;
+  delta.cas_failures -= before.cas_failures;
+  delta.nodes_traversed -= before.nodes_traversed;
+  delta.marked_skipped -= before.marked_skipped;
+  delta.helping_unlinks -= before.helping_unlinks;
+  delta.nodes_retired -= before.nodes_retired;
+  delta.nodes_freed -= before.nodes_freed;
+  return delta;
+}
 
-    for (auto &t : threads) {
-      t.join();
+/**
+ * @brief Run the benchmark on a fresh set with the given number of threads
+ *
+ * @param config Benchmark parameters
+ * @param num_threads Number of worker threads
+ * @return RunResult Throughput of the run
+ */
+template <typename SetType>
+RunResult run_benchmark(const BenchConfig &config, int num_threads) {
+  SetType set;
+  set_finger(set, config.finger, 0);
+  RunControl control;
+  // as many keys as there are threads popping at the same time, on average
+  // one each
+  control.spray_width = static_cast<unsigned>(num_threads);
+  if (config.first_touch) {
+    control.prefill_left = config.prefill;
+  } else {
+    FastRandom rng(0);
+    for (long size = 0; size < config.prefill;) {
+      if (set.insert(static_cast<int>(rng.next() % config.key_range)))
+        size++;
     }
+  }
 
-    auto end_time = std::chrono::high_resolution_clock::now();
-    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
-                        end_time - start_time)
-                        .count();
+  KeySpace keys(config.distribution, config.key_range, config.skew,
+                config.hot_keys_percent, config.hot_ops_percent);
 
-    std::cout << "Threads: " << num_threads << " | Time: " << duration
-              << " ms\n";
-    log_result("CoarseGrainList_insert", num_threads, duration);
+  std::vector<WorkerResult> results(num_threads);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < num_threads; ++i) {
+    threads.emplace_back(worker<SetType>, std::ref(set), std::cref(config),
+                         std::cref(keys), i, std::ref(control),
+                         std::ref(results[i]));
+  }
+  // thread creation and the prefill aren't measured, everyone starts at the
+  // same time
+  while (control.ready.load() < num_threads) {
+    this_thread::yield();
   }
 
-  std::cout << "Benchmarking CoarseGrainList mixed\n";
-
-  for (int num_threads = 1; num_threads <= MAX_THREADS; num_threads *= 2) {
-    CoarseGrainList<int> list;
+  // the prefill is counted too, and the reclaimer's counters are shared
+  // between runs
+  ListStats stats_before;
+  read_stats(set, stats_before, 0);
+  long allocated = AllocationStats::allocated().read();
+  auto start_time = std::chrono::steady_clock::now();
+  control.start = true;
+  if (config.distribution == KEYS_HOTSPOT && config.hot_shift_ms > 0) {
+    auto end = start_time + std::chrono::duration_cast<
+                                std::chrono::steady_clock::duration>(
+                                std::chrono::duration<double>(config.duration));
+    auto shift = std::chrono::milliseconds(config.hot_shift_ms);
+    for (auto next = start_time + shift; next < end; next += shift) {
+      std::this_thread::sleep_until(next);
+      control.hot_start.store(
+          (control.hot_start.load() + keys.hot_keys) % config.key_range,
+          memory_order_relaxed);
+    }
+    std::this_thread::sleep_until(end);
+  } else {
+    std::this_thread::sleep_for(
+        std::chrono::duration<double>(config.duration));
+  }
+  control.stop = true;
+  auto end_time = std::chrono::steady_clock::now();
 
-    auto start_time = std::chrono::high_resolution_clock::now();
+  for (auto &t : threads) {
+    t.join();
+  }
+  allocated = AllocationStats::allocated().read() - allocated;
 
-    std::vector<std::thread> threads;
-    for (int i = 0; i < num_threads; ++i) {
-      threads.emplace_back(coarse_grain_mixed_worker_all_delete, std::ref(list),
-                           i);
+  RunResult run;
+  ListStats stats_after;
+  if (read_stats(set, stats_after, 0)) {
+    run.has_stats = true;
+    run.stats = stats_between(stats_before, stats_after);
+  }
+  long total_ops = 0;
+  for (const auto &result : results) {
+    total_ops += result.ops;
+    for (int op = 0; op < NUM_OPERATIONS; ++op) {
+      run.latency[op].merge(result.latency[op]);
     }
+  }
+  double seconds = std::chrono::duration<double>(end_time - start_time).count();
+  run.ops_per_sec = total_ops / seconds;
+  run.allocs_per_op =
+      total_ops > 0 ? static_cast<double>(allocated) / total_ops : 0.0;
+  return run;
+}
 
-    for (auto &t : threads) {
-      t.join();
-    }
+typedef RunResult (*RunFunction)(const BenchConfig &, int);
+
+/**
+ * @brief A data structure that can be selected with --structures
+ */
+struct Structure {
+  const char *name;
+  /* one instantiation per backoff policy, picked with --backoff */
+  RunFunction run[NUM_BACKOFF_POLICIES];
+  /* whether it can run with --pop */
+  bool pops;
+};
+
+/**
+ * @brief A structure that has no backoff policy, --backoff doesn't change it
+ */
+template <typename SetType> Structure fixed(const char *name) {
+  RunFunction run = run_benchmark<SetType>;
+  return {name, {run, run, run}, has_pop_min<SetType>(0)};
+}
 
-    auto end_time = std::chrono::high_resolution_clock::now();
-    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
-                        end_time - start_time)
-                        .count();
+/**
+ * @brief A LockFreeList, instantiated with each backoff policy
+ */
+template <template <typename, typename> class Reclaim,
+          template <typename> class Alloc, typename Ordering>
+Structure with_backoff(const char *name) {
+  return {name,
+          {run_benchmark<LockFreeList<int, Reclaim, Alloc, Ordering>>,
+           run_benchmark<LockFreeList<int, Reclaim, Alloc, Ordering,
+                                      ExponentialBackoff>>,
+           run_benchmark<LockFreeList<int, Reclaim, Alloc, Ordering,
+                                      RandomizedBackoff>>},
+          true};
+}
 
-    std::cout << "Threads: " << num_threads << " | Time: " << duration
-              << " ms\n";
-    log_result("CoarseGrainList_mixed", num_threads, duration);
+static const Structure STRUCTURES[] = {
+    with_backoff<HazardPointer, HeapAllocator, SeqCstOrdering>("LockFreeList"),
+    with_backoff<PaddedHazardPointer, HeapAllocator, SeqCstOrdering>(
+        "LockFreeListPadded"),
+    with_backoff<EpochReclaimer, HeapAllocator, SeqCstOrdering>(
+        "LockFreeListEBR"),
+    with_backoff<HazardPointer, NodePool, SeqCstOrdering>("LockFreeListPool"),
+    fixed<LockFreeListNoReclaim<int>>("LockFreeListNoReclaim"),
+    with_backoff<HazardPointer, HeapAllocator, AcquireReleaseOrdering>(
+        "LockFreeListAcqRel"),
+    with_backoff<EpochReclaimer, HeapAllocator, AcquireReleaseOrdering>(
+        "LockFreeListEBRAcqRel"),
+    fixed<CoarseGrainList<int>>("CoarseGrainList"),
+    fixed<FlatCombiningList<int>>("FlatCombiningList"),
+    fixed<LazyList<int>>("LazyList"),
+    fixed<LockFreeSkipList<int>>("LockFreeSkipList"),
+    fixed<SplitOrderedSet<int>>("SplitOrderedSet"),
+    fixed<LockFreeUnrolledList<int>>("LockFreeUnrolledList"),
+};
+
+void print_usage() {
+  std::cout << "Usage: ./bench [options]\n"
+            << "  --duration=SECONDS        time measured per run (default "
+               "1)\n"
+            << "  --threads=N,N,...         thread counts (default powers of "
+               "two up to the core count)\n"
+            << "  --mix=FIND,INSERT,REMOVE  percentages that add up to 100 "
+               "(default 90,5,5)\n"
+            << "  --keys=RANGE              keys are drawn from [0, RANGE) "
+               "(default 1024)\n"
+            << "  --prefill=SIZE            keys inserted before the run "
+               "(default RANGE / 2)\n"
+            << "  --distribution=NAME       keys of the operations: uniform, "
+               "zipfian, hotspot\n"
+            << "                            or ryw (finds read the thread's "
+               "latest writes)\n"
+            << "                            (default uniform)\n"
+            << "  --skew=THETA              zipfian exponent in [0, 1) "
+               "(default 0.99)\n"
+            << "  --hot=KEYS,OPS            hotspot: OPS% of the operations go "
+               "to KEYS% of the\n"
+            << "                            keys (default 10,90)\n"
+            << "  --hot-shift=MS            hotspot: move the hot set every MS "
+               "milliseconds\n"
+            << "                            (default 0, never)\n"
+            << "  --pop=MODE                removes take the smallest key "
+               "(min) or one of the\n"
+            << "                            first THREADS keys (spray), in "
+               "the lists that\n"
+            << "                            support it (default off)\n"
+            << "  --structures=NAME,...     data structures to run (default "
+               "all)\n"
+            << "  --output=FILE             results file (default "
+               "benchmark_results.txt)\n"
+            << "  --format=FORMAT           results file format: text, csv "
+               "or json (default text)\n"
+            << "  --repeat=N                runs per structure and thread "
+               "count (default 1)\n"
+            << "  --latency=on|off          time every operation and report "
+               "percentiles (default on)\n"
+            << "  --pin=POLICY              pin the workers: none, compact "
+               "(SMT siblings first),\n"
+            << "                            scatter (alternate sockets) or "
+               "smt-last (default none)\n"
+            << "  --oversubscribe=on|off    allow more threads than hardware "
+               "threads (default off)\n"
+            << "  --first-touch=on|off      prefill from the workers, for "
+               "NUMA-local nodes (default off)\n"
+            << "  --backoff=POLICY          wait after a failed CAS in "
+               "LockFreeList: none,\n"
+            << "                            exponential or randomized "
+               "(default none)\n"
+            << "  --finger=on|off           start from the last position "
+               "of the thread, in the\n"
+            << "                            lists that support it (default "
+               "off)\n"
+            << "Structures:";
+  for (const auto &structure : STRUCTURES) {
+    std::cout << " " << structure.name;
   }
+  std::cout << "\n";
 }
 
-void lock_free_mixed_worker_all_delete(LockFreeList<int> &list, int thread_id) {
-  int base = thread_id * NUM_OPERATIONS;
-  for (int i = 0; i < NUM_OPERATIONS; ++i) {
-    if (i % 2 == 0) {
-      list.insert(base + i);
-    } else {
-      for (int attempt = 0; attempt < 3; ++attempt) {
-        if (list.remove(base + i - 1))
-          break;
-        this_thread::sleep_for(chrono::milliseconds(1 << attempt));
-      }
-    }
+std::vector<std::string> split(const std::string &list) {
+  std::vector<std::string> items;
+  std::istringstream stream(list);
+  std::string item;
+  while (std::getline(stream, item, ',')) {
+    items.push_back(item);
   }
+  return items;
 }
 
-void lock_free_insert_worker(LockFreeList<int> &list, int start) {
-  for (int i = start; i < NUM_OPERATIONS; ++i) {
-    list.insert(i);
+/**
+ * @brief Parse a non-negative integer
+ *
+ * @return long The value, or -1 if the text isn't a non-negative integer
+ */
+long parse_count(const std::string &text) {
+  char *end;
+  long value = std::strtol(text.c_str(), &end, 10);
+  if (text.empty() || *end != '\0' || value < 0) {
+    return -1;
   }
+  return value;
 }
 
-// Benchmark for LockFreeList
-void benchmark_lock_free() {
-  std::cout << "Benchmarking LockFreeList insert only\n";
-
-  for (int num_threads = 1; num_threads <= MAX_THREADS; num_threads *= 2) {
-    LockFreeList<int> list;
-
-    auto start_time = std::chrono::high_resolution_clock::now();
+/**
+ * @brief Parse an on/off switch
+ *
+ * @return true If the value was on or off
+ */
+bool parse_switch(const std::string &option, const std::string &value,
+                  bool &flag) {
+  if (value != "on" && value != "off") {
+    std::cerr << "Invalid " << option << " setting, expected on or off: "
+              << value << "\n";
+    return false;
+  }
+  flag = value == "on";
+  return true;
+}
 
-    std::vector<std::thread> threads;
-    for (int i = 0; i < num_threads; ++i) {
-      threads.emplace_back(lock_free_insert_worker, std::ref(list), i);
+/**
+ * @brief Fill the config from the command line
+ *
+ * @return true If every argument was valid
+ */
+bool parse_args(int argc, char **argv, BenchConfig &config) {
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    size_t eq = arg.find('=');
+    std::string option = arg.substr(0, eq);
+    std::string value = eq == std::string::npos ? "" : arg.substr(eq + 1);
+
+    if (option == "--duration") {
+      config.duration = std::atof(value.c_str());
+      if (config.duration <= 0) {
+        std::cerr << "Invalid duration: " << value << "\n";
+        return false;
+      }
+    } else if (option == "--threads") {
+      config.threads.clear();
+      for (const auto &item : split(value)) {
+        long threads = parse_count(item);
+        if (threads <= 0) {
+          std::cerr << "Invalid thread count: " << item << "\n";
+          return false;
+        }
+        config.threads.push_back(static_cast<int>(threads));
+      }
+    } else if (option == "--mix") {
+      std::vector<long> mix;
+      for (const auto &item : split(value)) {
+        mix.push_back(parse_count(item));
+      }
+      if (mix.size() != 3 || *std::min_element(mix.begin(), mix.end()) < 0 ||
+          mix[0] + mix[1] + mix[2] != 100) {
+        std::cerr << "Invalid mix, expected three percentages that add up to "
+                     "100: "
+                  << value << "\n";
+        return false;
+      }
+      config.find_percent = static_cast<int>(mix[0]);
+      config.insert_percent = static_cast<int>(mix[1]);
+      config.remove_percent = static_cast<int>(mix[2]);
+    } else if (option == "--keys") {
+      config.key_range = parse_count(value);
+      if (config.key_range <= 0) {
+        std::cerr << "Invalid key range: " << value << "\n";
+        return false;
+      }
+    } else if (option == "--prefill") {
+      config.prefill = parse_count(value);
+      if (config.prefill < 0) {
+        std::cerr << "Invalid prefill size: " << value << "\n";
+        return false;
+      }
+    } else if (option == "--distribution") {
+      bool known = false;
+      for (int distribution = 0; distribution < NUM_KEY_DISTRIBUTIONS;
+           ++distribution) {
+        if (value == KEY_DISTRIBUTION_NAMES[distribution]) {
+          config.distribution = static_cast<KeyDistribution>(distribution);
+          known = true;
+        }
+      }
+      if (!known) {
+        std::cerr << "Invalid key distribution: " << value << "\n";
+        return false;
+      }
+    } else if (option == "--skew") {
+      char *end;
+      config.skew = std::strtod(value.c_str(), &end);
+      if (value.empty() || *end != '\0' || config.skew < 0 ||
+          config.skew >= 1) {
+        std::cerr << "Invalid skew, expected a number in [0, 1): " << value
+                  << "\n";
+        return false;
+      }
+    } else if (option == "--hot") {
+      std::vector<long> hot;
+      for (const auto &item : split(value)) {
+        hot.push_back(parse_count(item));
+      }
+      if (hot.size() != 2 || hot[0] <= 0 || hot[0] > 100 || hot[1] < 0 ||
+          hot[1] > 100) {
+        std::cerr << "Invalid hot set, expected two percentages: " << value
+                  << "\n";
+        return false;
+      }
+      config.hot_keys_percent = static_cast<int>(hot[0]);
+      config.hot_ops_percent = static_cast<int>(hot[1]);
+    } else if (option == "--hot-shift") {
+      config.hot_shift_ms = parse_count(value);
+      if (config.hot_shift_ms < 0) {
+        std::cerr << "Invalid hot set shift period: " << value << "\n";
+        return false;
+      }
+    } else if (option == "--pop") {
+      bool known = false;
+      for (int mode = 0; mode < NUM_POP_MODES; ++mode) {
+        if (value == POP_NAMES[mode]) {
+          config.pop = static_cast<PopMode>(mode);
+          known = true;
+        }
+      }
+      if (!known) {
+        std::cerr << "Invalid pop mode: " << value << "\n";
+        return false;
+      }
+    } else if (option == "--structures") {
+      config.structures = split(value);
+    } else if (option == "--output") {
+      config.output = value;
+    } else if (option == "--format") {
+      bool known = false;
+      for (int format = 0; format < NUM_REPORT_FORMATS; ++format) {
+        if (value == REPORT_FORMAT_NAMES[format]) {
+          config.format = static_cast<ReportFormat>(format);
+          known = true;
+        }
+      }
+      if (!known) {
+        std::cerr << "Invalid results format: " << value << "\n";
+        return false;
+      }
+    } else if (option == "--repeat") {
+      config.repetitions = static_cast<int>(parse_count(value));
+      if (config.repetitions <= 0) {
+        std::cerr << "Invalid number of repetitions: " << value << "\n";
+        return false;
+      }
+    } else if (option == "--latency") {
+      if (!parse_switch(option, value, config.latency))
+        return false;
+    } else if (option == "--oversubscribe") {
+      if (!parse_switch(option, value, config.oversubscribe))
+        return false;
+    } else if (option == "--first-touch") {
+      if (!parse_switch(option, value, config.first_touch))
+        return false;
+    } else if (option == "--finger") {
+      if (!parse_switch(option, value, config.finger))
+        return false;
+    } else if (option == "--pin") {
+      if (value == "none") {
+        config.pin = PIN_NONE;
+      } else if (value == "compact") {
+        config.pin = PIN_COMPACT;
+      } else if (value == "scatter") {
+        config.pin = PIN_SCATTER;
+      } else if (value == "smt-last") {
+        config.pin = PIN_SMT_LAST;
+      } else {
+        std::cerr << "Invalid pinning policy: " << value << "\n";
+        return false;
+      }
+    } else if (option == "--backoff") {
+      bool known = false;
+      for (int policy = 0; policy < NUM_BACKOFF_POLICIES; ++policy) {
+        if (value == BACKOFF_NAMES[policy]) {
+          config.backoff = static_cast<BackoffPolicy>(policy);
+          known = true;
+        }
+      }
+      if (!known) {
+        std::cerr << "Invalid backoff policy: " << value << "\n";
+        return false;
+      }
+    } else {
+      print_usage();
+      return false;
     }
+  }
 
-    for (auto &t : threads) {
-      t.join();
+  if (config.prefill < 0) {
+    config.prefill = config.key_range / 2;
+  }
+  if (config.prefill > config.key_range) {
+    std::cerr << "Can't prefill more keys than the key range\n";
+    return false;
+  }
+  config.topology = read_topology();
+  if (config.pin != PIN_NONE) {
+    config.cpu_order = pinning_order(config.topology, config.pin);
+  }
+  int hardware_threads = static_cast<int>(config.topology.size());
+  if (config.threads.empty()) {
+    for (int threads = 1; threads < hardware_threads; threads *= 2) {
+      config.threads.push_back(threads);
     }
-
-    auto end_time = std::chrono::high_resolution_clock::now();
-    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
-                        end_time - start_time)
-                        .count();
-
-    std::cout << "Threads: " << num_threads << " | Time: " << duration
-              << " ms\n";
-    log_result("LockFreeList_insert", num_threads, duration);
+    config.threads.push_back(hardware_threads);
   }
-
-  std::cout << "Benchmarking LockFreeList mixed\n";
-
-  for (int num_threads = 1; num_threads <= MAX_THREADS; num_threads *= 2) {
-    LockFreeList<int> list;
-
-    auto start_time = std::chrono::high_resolution_clock::now();
-
-    std::vector<std::thread> threads;
-    for (int i = 0; i < num_threads; ++i) {
-      threads.emplace_back(lock_free_mixed_worker_all_delete, std::ref(list),
-                           i);
+  for (int threads : config.threads) {
+    if (threads > hardware_threads && !config.oversubscribe) {
+      std::cerr << threads << " threads but only " << hardware_threads
+                << " hardware threads, use --oversubscribe=on to run it "
+                   "anyway\n";
+      return false;
     }
-
-    for (auto &t : threads) {
-      t.join();
+  }
+  for (const auto &name : config.structures) {
+    bool known = false;
+    for (const auto &structure : STRUCTURES) {
+      known = known || name == structure.name;
+    }
+    if (!known) {
+      std::cerr << "Unknown structure: " << name << "\n";
+      return false;
     }
-
-    auto end_time = std::chrono::high_resolution_clock::now();
-    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
-                        end_time - start_time)
-                        .count();
-
-    std::cout << "Threads: " << num_threads << " | Time: " << duration
-              << " ms\n";
-    log_result("LockFreeList_mixed", num_threads, duration);
   }
+  return true;
 }
 
-void lock_free_no_reclaim_mixed_worker_all_delete(LockFreeListNoReclaim<int> &list, int thread_id) {
-  int base = thread_id * NUM_OPERATIONS;
-  for (int i = 0; i < NUM_OPERATIONS; ++i) {
-    if (i % 2 == 0) {
-      list.insert(base + i);
-    } else {
-      for (int attempt = 0; attempt < 3; ++attempt) {
-        if (list.remove(base + i - 1))
-          break;
-        this_thread::sleep_for(chrono::milliseconds(1 << attempt));
-      }
-    }
+bool selected(const BenchConfig &config, const std::string &name) {
+  if (config.structures.empty()) {
+    return true;
   }
+  return std::find(config.structures.begin(), config.structures.end(), name) !=
+         config.structures.end();
 }
 
-void lock_free_no_reclaim_insert_worker(LockFreeListNoReclaim<int> &list, int start) {
-  for (int i = start; i < NUM_OPERATIONS; ++i) {
-    list.insert(i);
+/**
+ * @brief Count the physical cores, SMT siblings share one
+ */
+int count_cores(const std::vector<CpuInfo> &topology) {
+  std::set<std::pair<int, int>> cores;
+  for (const auto &info : topology) {
+    cores.insert(std::make_pair(info.package, info.core));
   }
+  return static_cast<int>(cores.size());
 }
 
-void benchmark_lock_free_no_reclaim() {
-  std::cout << "Benchmarking LockFreeListNoReclaim insert only\n";
-
-  for (int num_threads = 1; num_threads <= MAX_THREADS; num_threads *= 2) {
-    LockFreeListNoReclaim<int> list;
-
-    auto start_time = std::chrono::high_resolution_clock::now();
-
-    std::vector<std::thread> threads;
-    for (int i = 0; i < num_threads; ++i) {
-      threads.emplace_back(lock_free_no_reclaim_insert_worker, std::ref(list), i);
-    }
+/**
+ * @brief Describe a run for the results file, before the measurements are
+ * filled in
+ */
+BenchRecord make_record(const BenchConfig &config, const char *structure,
+                        int num_threads) {
+  BenchRecord record;
+  record.structure = structure;
+  record.workload = config.workload();
+  record.threads = num_threads;
+  record.find_percent = config.find_percent;
+  record.insert_percent = config.insert_percent;
+  record.remove_percent = config.remove_percent;
+  record.key_range = config.key_range;
+  record.prefill = config.prefill;
+  record.distribution = KEY_DISTRIBUTION_NAMES[config.distribution];
+  record.duration = config.duration;
+  record.backoff = BACKOFF_NAMES[config.backoff];
+  record.finger = config.finger;
+  record.pin = PIN_NAMES[config.pin];
+  record.first_touch = config.first_touch;
+  return record;
+}
 
-    for (auto &t : threads) {
-      t.join();
+/**
+ * @brief Print the hardware the benchmark runs on and where the workers go
+ */
+void print_topology(const BenchConfig &config) {
+  std::set<int> packages, nodes;
+  for (const auto &info : config.topology) {
+    packages.insert(info.package);
+    nodes.insert(info.node);
+  }
+  std::cout << "Topology: " << packages.size() << " sockets, " << nodes.size()
+            << " NUMA nodes, " << count_cores(config.topology) << " cores, "
+            << config.topology.size() << " hardware threads\n";
+
+  std::cout << "Pinning: " << PIN_NAMES[config.pin];
+  if (config.pin != PIN_NONE) {
+    std::cout << ", worker i runs on CPU";
+    for (int cpu : config.cpu_order) {
+      std::cout << " " << cpu;
     }
-
-    auto end_time = std::chrono::high_resolution_clock::now();
-    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
-                        end_time - start_time)
-                        .count();
-
-    std::cout << "Threads: " << num_threads << " | Time: " << duration
-              << " ms\n";
-    log_result("LockFreeListNoReclaim_insert", num_threads, duration);
   }
+  std::cout << "\n";
+}
 
-  std::cout << "Benchmarking LockFreeListNoReclaim mixed\n";
-
-  for (int num_threads = 1; num_threads <= MAX_THREADS; num_threads *= 2) {
-    LockFreeListNoReclaim<int> list;
+int main(int argc, char **argv) {
+  BenchConfig config;
+  if (!parse_args(argc, argv, config)) {
+    return 1;
+  }
 
-    auto start_time = std::chrono::high_resolution_clock::now();
+  std::ofstream result_file(config.output);
+  std::string workload = config.workload();
+  print_topology(config);
+  std::cout << "Workload " << workload << ", " << config.duration
+            << " s per run";
+  if (config.repetitions > 1) {
+    std::cout << ", " << config.repetitions << " runs each";
+  }
+  std::cout << "\n";
 
-    std::vector<std::thread> threads;
-    for (int i = 0; i < num_threads; ++i) {
-      threads.emplace_back(lock_free_no_reclaim_mixed_worker_all_delete, std::ref(list),
-                           i);
+  std::vector<BenchRecord> records;
+  for (const auto &structure : STRUCTURES) {
+    if (!selected(config, structure.name)) {
+      continue;
     }
-
-    for (auto &t : threads) {
-      t.join();
+    if (config.pop != POP_OFF && !structure.pops) {
+      std::cout << "Skipping " << structure.name << ", it has no pop_min\n";
+      continue;
+    }
+    std::cout << "Benchmarking " << structure.name << "\n";
+    for (int num_threads : config.threads) {
+      // the latencies of every repetition are merged, the contention counters
+      // are the ones of the last repetition
+      RunResult result;
+      std::vector<double> throughputs;
+      double allocs_per_op = 0;
+      for (int repetition = 0; repetition < config.repetitions; ++repetition) {
+        RunResult run = structure.run[config.backoff](config, num_threads);
+        throughputs.push_back(run.ops_per_sec);
+        allocs_per_op += run.allocs_per_op / config.repetitions;
+        for (int op = 0; op < NUM_OPERATIONS; ++op) {
+          run.latency[op].merge(result.latency[op]);
+        }
+        result = run;
+      }
+      BenchRecord record = make_record(config, structure.name, num_threads);
+      record.throughput = summarize(throughputs);
+      record.allocs_per_op = allocs_per_op;
+
+      std::cout << "Threads: " << std::setw(4) << num_threads
+                << " | Throughput: " << std::fixed << std::setprecision(0)
+                << std::setw(12) << record.throughput.median << " ops/s";
+      if (config.repetitions > 1) {
+        std::cout << " +- " << record.throughput.stddev;
+      }
+      std::cout << " | Allocations: " << std::setprecision(3)
+                << allocs_per_op << " per op\n";
+      for (int op = 0; op < NUM_OPERATIONS; ++op) {
+        const LatencyHistogram &latency = result.latency[op];
+        LatencySummary summary;
+        record.operations.push_back(OPERATION_NAMES[op]);
+        if (config.latency && latency.count() > 0) {
+          summary.recorded = true;
+          summary.p50 = latency.percentile(50);
+          summary.p99 = latency.percentile(99);
+          summary.p999 = latency.percentile(99.9);
+          summary.max = latency.max_recorded();
+          std::cout << "  " << std::left << std::setw(6) << OPERATION_NAMES[op]
+                    << std::right << " latency (ns) | p50: " << std::setw(8)
+                    << summary.p50 << " | p99: " << std::setw(8)
+                    << summary.p99 << " | p99.9: " << std::setw(8)
+                    << summary.p999 << " | max: " << summary.max << "\n";
+        }
+        record.latency.push_back(summary);
+      }
+      if (result.has_stats && result.stats.operations > 0) {
+        const ListStats &stats = result.stats;
+        double ops = static_cast<double>(stats.operations);
+        std::cout << std::setprecision(3)
+                  << "  per op: restarts " << stats.search_restarts / ops
+                  << " | CAS failures " << stats.cas_failures / ops
+                  << " | traversed " << stats.nodes_traversed / ops
+                  << " | marked skipped " << stats.marked_skipped / ops
+                  << " | helping unlinks " << stats.helping_unlinks / ops
+                  << "\n  reclamation: retired " << stats.nodes_retired
+                  << " | freed " << stats.nodes_freed
+                  << " | waiting to be freed " << stats.retired_pending
+                  << "\n";
+      }
+      records.push_back(record);
     }
-
-    auto end_time = std::chrono::high_resolution_clock::now();
-    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
-                        end_time - start_time)
-                        .count();
-
-    std::cout << "Threads: " << num_threads << " | Time: " << duration
-              << " ms\n";
-    log_result("LockFreeListNoReclaim_mixed", num_threads, duration);
   }
-}
 
-int main() {
-  benchmark_lock_free();
-  benchmark_coarse_grain();
-  benchmark_lock_free_no_reclaim();
+  ReportMetadata metadata = collect_metadata(
+      count_cores(config.topology), static_cast<int>(config.topology.size()));
+  switch (config.format) {
+  case REPORT_CSV:
+    write_csv_report(result_file, metadata, records);
+    break;
+  case REPORT_JSON:
+    write_json_report(result_file, metadata, records);
+    break;
+  default:
+    write_text_report(result_file, records);
+  }
   return 0;
-}
\ No newline at end of file
+}
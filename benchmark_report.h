@@ -0,0 +1,316 @@
+/**
+ * @file benchmark_report.h
+ * @author Sihan Zhuang (sihanzhu)
+ * @brief This file contains the records the benchmark writes to its results
+ * file, and the text, CSV and JSON formats they can be written in.
+ * @note The text format is the original one, a <structure>_<workload>,
+ * <threads>,<ops per second> line per run, which plot_benchmark.py reads. The
+ * CSV and JSON formats also carry the workload parameters, the latency
+ * percentiles, the statistics over the repetitions and the build and host the
+ * results come from, so that compare_benchmark.py can tell whether two result
+ * files differ by more than the noise.
+ */
+
+#ifndef BENCHMARK_REPORT_H
+#define BENCHMARK_REPORT_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <ctime>
+#include <iomanip>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+using namespace std;
+
+/* set by the Makefile, see the bench target */
+#ifndef BENCH_BUILD_FLAGS
+#define BENCH_BUILD_FLAGS "unknown"
+#endif
+#ifndef BENCH_GIT_COMMIT
+#define BENCH_GIT_COMMIT "unknown"
+#endif
+
+enum ReportFormat { REPORT_TEXT, REPORT_CSV, REPORT_JSON, NUM_REPORT_FORMATS };
+
+static const char *REPORT_FORMAT_NAMES[NUM_REPORT_FORMATS] = {"text", "csv",
+                                                              "json"};
+
+/**
+ * @brief Where and from what the results were produced
+ */
+struct ReportMetadata {
+  string host;
+  int cores = 0;
+  int hardware_threads = 0;
+  string compiler;
+  string flags = BENCH_BUILD_FLAGS;
+  string commit = BENCH_GIT_COMMIT;
+  /* UTC, ISO 8601 */
+  string timestamp;
+};
+
+/**
+ * @brief Describe the machine and the build of the running benchmark
+ *
+ * @param cores Number of physical cores the benchmark may run on
+ * @param hardware_threads Number of hardware threads it may run on
+ * @return ReportMetadata The metadata
+ */
+inline ReportMetadata collect_metadata(int cores, int hardware_threads) {
+  ReportMetadata metadata;
+  char host[256] = "";
+  if (gethostname(host, sizeof(host) - 1) == 0) {
+    metadata.host = host;
+  }
+  metadata.cores = cores;
+  metadata.hardware_threads = hardware_threads;
+#if defined(__clang__)
+  metadata.compiler = string("clang ") + __clang_version__;
+#elif defined(__GNUC__)
+  metadata.compiler = string("g++ ") + __VERSION__;
+#else
+  metadata.compiler = "unknown";
+#endif
+  time_t now = time(nullptr);
+  char timestamp[32];
+  strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+  metadata.timestamp = timestamp;
+  return metadata;
+}
+
+/**
+ * @brief Statistics of a value measured once per repetition
+ */
+struct RepetitionStats {
+  int count = 0;
+  double median = 0;
+  double mean = 0;
+  /* sample standard deviation, 0 with a single repetition */
+  double stddev = 0;
+  double min = 0;
+  double max = 0;
+};
+
+inline RepetitionStats summarize(vector<double> values) {
+  RepetitionStats stats;
+  stats.count = static_cast<int>(values.size());
+  if (values.empty()) {
+    return stats;
+  }
+  sort(values.begin(), values.end());
+  size_t middle = values.size() / 2;
+  stats.median = values.size() % 2 == 1
+                     ? values[middle]
+                     : (values[middle - 1] + values[middle]) / 2;
+  double sum = 0;
+  for (double value : values) {
+    sum += value;
+  }
+  stats.mean = sum / values.size();
+  if (values.size() > 1) {
+    double squares = 0;
+    for (double value : values) {
+      squares += (value - stats.mean) * (value - stats.mean);
+    }
+    stats.stddev = sqrt(squares / (values.size() - 1));
+  }
+  stats.min = values.front();
+  stats.max = values.back();
+  return stats;
+}
+
+/**
+ * @brief Latency percentiles of one operation type, in nanoseconds
+ */
+struct LatencySummary {
+  /* false if the operation wasn't timed or never ran */
+  bool recorded = false;
+  uint64_t p50 = 0;
+  uint64_t p99 = 0;
+  uint64_t p999 = 0;
+  uint64_t max = 0;
+};
+
+/**
+ * @brief Result of one structure with one thread count, over all the
+ * repetitions
+ */
+struct BenchRecord {
+  string structure;
+  string workload;
+  int threads = 0;
+  int find_percent = 0;
+  int insert_percent = 0;
+  int remove_percent = 0;
+  long key_range = 0;
+  long prefill = 0;
+  /* the parameters of the skewed distributions are in the workload name */
+  string distribution;
+  double duration = 0;
+  string backoff;
+  bool finger = false;
+  string pin;
+  bool first_touch = false;
+  RepetitionStats throughput;
+  double allocs_per_op = 0;
+  /* indexed like OPERATION_NAMES in benchmark.cpp */
+  vector<string> operations;
+  vector<LatencySummary> latency;
+};
+
+/**
+ * @brief Quote a string for CSV, if it needs to be
+ */
+inline string csv_field(const string &text) {
+  if (text.find_first_of(",\"\n") == string::npos) {
+    return text;
+  }
+  string quoted = "\"";
+  for (char c : text) {
+    if (c == '"')
+      quoted += '"';
+    quoted += c;
+  }
+  return quoted + "\"";
+}
+
+/**
+ * @brief Quote and escape a string for JSON
+ */
+inline string json_string(const string &text) {
+  ostringstream quoted;
+  quoted << '"';
+  for (char c : text) {
+    if (c == '"' || c == '\\') {
+      quoted << '\\' << c;
+    } else if (c == '\n') {
+      quoted << "\\n";
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      quoted << "\\u" << hex << setw(4) << setfill('0') << int(c) << dec;
+    } else {
+      quoted << c;
+    }
+  }
+  quoted << '"';
+  return quoted.str();
+}
+
+/**
+ * @brief Write the records as <structure>_<workload>,<threads>,<ops per
+ * second> lines, the median over the repetitions
+ */
+inline void write_text_report(ostream &out,
+                              const vector<BenchRecord> &records) {
+  for (const auto &record : records) {
+    out << record.structure << "_" << record.workload << "," << record.threads
+        << "," << fixed << setprecision(0) << record.throughput.median << "\n";
+  }
+}
+
+/**
+ * @brief Write the records as CSV with a header line. The metadata is repeated
+ * on every line so that each line stands on its own
+ */
+inline void write_csv_report(ostream &out, const ReportMetadata &metadata,
+                             const vector<BenchRecord> &records) {
+  out << "structure,workload,threads,find_percent,insert_percent,"
+         "remove_percent,key_range,prefill,distribution,duration,backoff,"
+         "finger,pin,"
+         "first_touch,repetitions,ops_per_sec_median,ops_per_sec_mean,"
+         "ops_per_sec_stddev,ops_per_sec_min,ops_per_sec_max,allocs_per_op";
+  if (!records.empty()) {
+    for (const auto &name : records[0].operations) {
+      out << "," << name << "_p50_ns," << name << "_p99_ns," << name
+          << "_p999_ns," << name << "_max_ns";
+    }
+  }
+  out << ",host,cores,hardware_threads,compiler,flags,commit,timestamp\n";
+
+  for (const auto &record : records) {
+    const RepetitionStats &ops = record.throughput;
+    out << csv_field(record.structure) << "," << csv_field(record.workload)
+        << "," << record.threads << "," << record.find_percent << ","
+        << record.insert_percent << "," << record.remove_percent << ","
+        << record.key_range << "," << record.prefill << ","
+        << record.distribution << ","
+        << defaultfloat << record.duration << "," << record.backoff << ","
+        << (record.finger ? "on" : "off") << "," << record.pin << ","
+        << (record.first_touch ? "on" : "off") << "," << ops.count << ","
+        << fixed << setprecision(0) << ops.median << "," << ops.mean << ","
+        << ops.stddev << "," << ops.min << "," << ops.max << ","
+        << setprecision(4) << record.allocs_per_op;
+    for (const auto &latency : record.latency) {
+      if (latency.recorded) {
+        out << "," << latency.p50 << "," << latency.p99 << ","
+            << latency.p999 << "," << latency.max;
+      } else {
+        out << ",,,,";
+      }
+    }
+    out << "," << csv_field(metadata.host) << "," << metadata.cores << ","
+        << metadata.hardware_threads << "," << csv_field(metadata.compiler)
+        << "," << csv_field(metadata.flags) << ","
+        << csv_field(metadata.commit) << "," << metadata.timestamp << "\n";
+  }
+}
+
+/**
+ * @brief Write the metadata and the records as a single JSON document
+ */
+inline void write_json_report(ostream &out, const ReportMetadata &metadata,
+                              const vector<BenchRecord> &records) {
+  out << "{\n  \"metadata\": {\"host\": " << json_string(metadata.host)
+      << ", \"cores\": " << metadata.cores
+      << ", \"hardware_threads\": " << metadata.hardware_threads
+      << ",\n               \"compiler\": " << json_string(metadata.compiler)
+      << ", \"flags\": " << json_string(metadata.flags)
+      << ",\n               \"commit\": " << json_string(metadata.commit)
+      << ", \"timestamp\": " << json_string(metadata.timestamp)
+      << "},\n  \"results\": [";
+
+  for (size_t i = 0; i < records.size(); ++i) {
+    const BenchRecord &record = records[i];
+    const RepetitionStats &ops = record.throughput;
+    out << (i == 0 ? "\n" : ",\n") << "    {\"structure\": "
+        << json_string(record.structure)
+        << ", \"workload\": " << json_string(record.workload)
+        << ", \"threads\": " << record.threads
+        << ",\n     \"parameters\": {\"find_percent\": " << record.find_percent
+        << ", \"insert_percent\": " << record.insert_percent
+        << ", \"remove_percent\": " << record.remove_percent
+        << ", \"key_range\": " << record.key_range
+        << ", \"prefill\": " << record.prefill
+        << ", \"distribution\": " << json_string(record.distribution)
+        << ", \"duration\": " << defaultfloat << record.duration
+        << ", \"backoff\": " << json_string(record.backoff)
+        << ", \"finger\": " << (record.finger ? "true" : "false")
+        << ", \"pin\": " << json_string(record.pin)
+        << ", \"first_touch\": " << (record.first_touch ? "true" : "false")
+        << "},\n     \"ops_per_sec\": {\"repetitions\": " << ops.count
+        << fixed << setprecision(0) << ", \"median\": " << ops.median
+        << ", \"mean\": " << ops.mean << ", \"stddev\": " << ops.stddev
+        << ", \"min\": " << ops.min << ", \"max\": " << ops.max
+        << "},\n     \"allocs_per_op\": " << setprecision(4)
+        << record.allocs_per_op << ",\n     \"latency_ns\": {";
+    for (size_t op = 0; op < record.latency.size(); ++op) {
+      const LatencySummary &latency = record.latency[op];
+      out << (op == 0 ? "" : ", ") << json_string(record.operations[op])
+          << ": ";
+      if (latency.recorded) {
+        out << "{\"p50\": " << latency.p50 << ", \"p99\": " << latency.p99
+            << ", \"p999\": " << latency.p999 << ", \"max\": " << latency.max
+            << "}";
+      } else {
+        out << "null";
+      }
+    }
+    out << "}}";
+  }
+  out << "\n  ]\n}\n";
+}
+
+#endif // BENCHMARK_REPORT_H
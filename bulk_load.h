@@ -0,0 +1,123 @@
+/**
+ * @file bulk_load.h
+ * @author Sihan Zhuang (sihanzhu)
+ * @brief This file contains the helpers the lock-free lists use to build a
+ * list from a range of keys in linear time, instead of one insert (and one
+ * traversal) per key.
+ * @note The keys are sorted once, then split into segments that are linked by
+ * several threads at the same time. The segments are stitched together at the
+ * end, and the caller publishes the whole chain with a single store. With
+ * NodePool, each thread carves its nodes out of its own slabs, so the nodes of
+ * a segment are next to each other in memory in list order.
+ */
+
+#ifndef BULK_LOAD_H
+#define BULK_LOAD_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+using namespace std;
+
+/**
+ * @brief Segments smaller than this are not worth a thread of their own
+ */
+constexpr size_t BULK_LOAD_MIN_SEGMENT = 16384;
+
+/**
+ * @brief Copy a range of keys, sorted and without duplicates
+ *
+ * @param first Iterator to the first key
+ * @param last Iterator past the last key
+ * @return vector<KeyType> The distinct keys in ascending order
+ */
+template <typename KeyType, typename Iterator>
+vector<KeyType> sorted_bulk_keys(Iterator first, Iterator last) {
+  vector<KeyType> keys(first, last);
+  if (!is_sorted(keys.begin(), keys.end())) {
+    sort(keys.begin(), keys.end());
+  }
+  keys.erase(unique(keys.begin(), keys.end(),
+                    [](const KeyType &a, const KeyType &b) {
+                      return !(a < b) && !(b < a);
+                    }),
+             keys.end());
+  return keys;
+}
+
+/**
+ * @brief Allocate and link the nodes of a run of keys. The last node's next
+ * pointer is left null
+ *
+ * @param keys First key of the run
+ * @param count Number of keys, at least 1
+ * @param last Set to the last node of the run
+ * @return Node* The first node of the run
+ */
+template <typename Node, typename Allocator, typename KeyType>
+Node *link_bulk_segment(const KeyType *keys, size_t count, Node **last) {
+  Node *first = Allocator::new_node(keys[0]);
+  Node *prev = first;
+  for (size_t i = 1; i < count; ++i) {
+    Node *node = Allocator::new_node(keys[i]);
+    // nobody else can see the nodes until the chain is published
+    prev->next.store(node, memory_order_relaxed);
+    prev = node;
+  }
+  *last = prev;
+  return first;
+}
+
+/**
+ * @brief Build the chain of nodes holding sorted keys, ending at tail
+ *
+ * @param keys Keys in ascending order, without duplicates
+ * @param tail Node the last key points to
+ * @param num_threads Maximum number of threads linking segments, 0 to use
+ * one per hardware thread
+ * @return Node* The first node of the chain, tail if there are no keys
+ */
+template <typename Node, typename Allocator, typename KeyType>
+Node *build_bulk_chain(const vector<KeyType> &keys, Node *tail,
+                       unsigned num_threads) {
+  if (keys.empty()) {
+    return tail;
+  }
+  if (num_threads == 0) {
+    num_threads = max(1u, thread::hardware_concurrency());
+  }
+  size_t segments = (keys.size() + BULK_LOAD_MIN_SEGMENT - 1) /
+                    BULK_LOAD_MIN_SEGMENT;
+  if (segments > num_threads) {
+    segments = num_threads;
+  }
+
+  vector<Node *> firsts(segments), lasts(segments);
+  auto link = [&](size_t segment) {
+    size_t begin = keys.size() * segment / segments;
+    size_t end = keys.size() * (segment + 1) / segments;
+    firsts[segment] = link_bulk_segment<Node, Allocator>(
+        keys.data() + begin, end - begin, &lasts[segment]);
+  };
+
+  // the calling thread links the first segment itself
+  vector<thread> threads;
+  for (size_t segment = 1; segment < segments; ++segment) {
+    threads.push_back(thread(link, segment));
+  }
+  link(0);
+  // joining makes the other threads' nodes visible to this one
+  for (auto &t : threads) {
+    t.join();
+  }
+
+  for (size_t segment = 0; segment + 1 < segments; ++segment) {
+    lasts[segment]->next.store(firsts[segment + 1], memory_order_relaxed);
+  }
+  lasts[segments - 1]->next.store(tail, memory_order_relaxed);
+  return firsts[0];
+}
+
+#endif // BULK_LOAD_H
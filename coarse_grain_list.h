@@ -3,114 +3,321 @@
  * @author Sihan Zhuang (sihanzhu)
  * @brief This is a simple implementation of a multi-threaded linked list with
  * coarse-grain locking.
- * @note Modern C++ features such as smart pointers and mutex with lock guards
- * are used to simplify the implementation.
+ * @note Nodes are plain pointers owned by the list: the lock already keeps
+ * them alive, so reference counting would only add two atomic operations per
+ * hop. Locking uses std::shared_mutex with lock guards.
  */
 
 #ifndef COARSE_GRAIN_LIST_H
 #define COARSE_GRAIN_LIST_H
 
+#include "finger.h"
+#include "node_pool.h"
+#include <atomic>
 #include <iostream>
-#include <memory>
 #include <mutex>
+#include <shared_mutex>
+#include <vector>
 using namespace std;
 
 template <typename T> struct CoarseGrainNode {
   T key;
-  std::shared_ptr<CoarseGrainNode<T>> next;
+  /* owned by the list, only changed with the lock held exclusively */
+  CoarseGrainNode<T> *next;
   CoarseGrainNode(const T &key) : key(key), next(nullptr) {}
   CoarseGrainNode() : next(nullptr) {}
 };
 
-template <typename T> class CoarseGrainList {
+/**
+ * @brief A sorted linked list protected by a single reader-writer lock.
+ * Lookups and scans share the lock, so they run in parallel with each other,
+ * while inserts and removes take it exclusively
+ *
+ * @tparam T Type of the keys
+ * @tparam Alloc Node allocator, either HeapAllocator or NodePool
+ */
+template <typename T, template <typename> class Alloc = HeapAllocator>
+class CoarseGrainList {
 private:
+  typedef Alloc<CoarseGrainNode<T>> Allocator;
+
   // sentinel nodes
-  shared_ptr<CoarseGrainNode<T>> head;
-  shared_ptr<CoarseGrainNode<T>> tail;
-  mutable mutex list_mutex;
+  CoarseGrainNode<T> *head;
+  CoarseGrainNode<T> *tail;
+  mutable shared_mutex list_mutex;
+  /* only written under the exclusive lock, atomic so that size() can read it
+   * without taking the lock */
+  atomic<size_t> key_count{0};
+  /* number of nodes freed so far, a finger is stale once it changes. Only
+   * written under the exclusive lock */
+  unsigned long removals = 0;
+  /* identifies the list in the fingers of the threads, see finger.h */
+  const uint64_t list_id = next_list_id();
+  bool finger_enabled = false;
+
+  static Finger<CoarseGrainNode<T>> &local_finger() {
+    static thread_local Finger<CoarseGrainNode<T>> finger;
+    return finger;
+  }
+
+  /**
+   * @brief Pick the node a search for the key starts from: the calling
+   * thread's finger if it's enabled, no node was freed since it was saved and
+   * it's before the key, the head otherwise
+   * @note The lock must be held
+   */
+  CoarseGrainNode<T> *finger_start(const T &key) const {
+    Finger<CoarseGrainNode<T>> &finger = local_finger();
+    if (!finger_enabled || finger.list_id != list_id ||
+        finger.stamp != removals || !(finger.node->key < key)) {
+      return head;
+    }
+    return finger.node;
+  }
+
+  /* the lock must be held */
+  void save_finger(CoarseGrainNode<T> *node) const {
+    if (finger_enabled && node != head) {
+      Finger<CoarseGrainNode<T>> &finger = local_finger();
+      finger.list_id = list_id;
+      finger.node = node;
+      finger.stamp = removals;
+    }
+  }
+
+  /**
+   * @brief Find the last node whose key is less than key, starting from
+   * current
+   * @note The lock must be held
+   */
+  CoarseGrainNode<T> *find_before(CoarseGrainNode<T> *current,
+                                  const T &key) const {
+    while (current->next != tail && current->next->key < key) {
+      current = current->next;
+    }
+    return current;
+  }
+
+  /**
+   * @brief Node the next key of a batch is searched from: where the previous
+   * key's search stopped, or the head if the batch isn't sorted there
+   */
+  CoarseGrainNode<T> *batch_start(CoarseGrainNode<T> *current,
+                                  const T &key) const {
+    return current == head || current->key < key ? current : head;
+  }
 
 public:
   CoarseGrainList() {
-    head = make_shared<CoarseGrainNode<T>>();
-    tail = make_shared<CoarseGrainNode<T>>();
+    head = Allocator::new_node();
+    tail = Allocator::new_node();
     head->next = tail;
   }
 
-  ~CoarseGrainList() { head->next = nullptr; }
+  /**
+   * @brief Destroy the Coarse Grain List object, one node at a time so that
+   * a long list can't overflow the stack
+   */
+  ~CoarseGrainList() {
+    CoarseGrainNode<T> *current = head;
+    while (current != nullptr) {
+      CoarseGrainNode<T> *next = current->next;
+      Allocator::delete_node(current);
+      current = next;
+    }
+  }
+
+  CoarseGrainList(const CoarseGrainList &) = delete;
+  CoarseGrainList &operator=(const CoarseGrainList &) = delete;
 
   CoarseGrainNode<T> *get_head() {
-    lock_guard<mutex> lock(list_mutex);
-    return head.get();
+    shared_lock<shared_mutex> lock(list_mutex);
+    return head;
   }
 
   CoarseGrainNode<T> *get_tail() {
-    lock_guard<mutex> lock(list_mutex);
-    return tail.get();
+    shared_lock<shared_mutex> lock(list_mutex);
+    return tail;
   }
 
   CoarseGrainNode<T> *get_front() {
-    lock_guard<mutex> lock(list_mutex);
-    return head->next.get();
+    shared_lock<shared_mutex> lock(list_mutex);
+    return head->next;
   }
 
   CoarseGrainNode<T> *get_next(CoarseGrainNode<T> *current) {
-    lock_guard<mutex> lock(list_mutex);
-    return current->next.get();
+    shared_lock<shared_mutex> lock(list_mutex);
+    return current->next;
   }
 
   bool insert(const T key) {
-    lock_guard<mutex> lock(list_mutex);
-    shared_ptr<CoarseGrainNode<T>> new_node =
-        make_shared<CoarseGrainNode<T>>(key);
-    auto current = head;
-
-    while (current->next != tail && current->next->key < key) {
-      current = current->next;
-    }
+    lock_guard<shared_mutex> lock(list_mutex);
+    CoarseGrainNode<T> *current = find_before(finger_start(key), key);
+    save_finger(current);
 
     // check for duplicates
     if (current->next != tail && current->next->key == key) {
       return false;
     }
 
+    // only allocate once we know the insert succeeds
+    CoarseGrainNode<T> *new_node = Allocator::new_node(key);
     new_node->next = current->next;
     current->next = new_node;
+    key_count.store(key_count.load(memory_order_relaxed) + 1,
+                    memory_order_relaxed);
 
     return true;
   }
 
   bool remove(const T key) {
-    lock_guard<mutex> lock(list_mutex);
-    auto current = head;
-
-    while (current->next != tail && current->next->key < key) {
-      current = current->next;
-    }
+    lock_guard<shared_mutex> lock(list_mutex);
+    CoarseGrainNode<T> *current = find_before(finger_start(key), key);
 
     if (current->next != tail && current->next->key == key) {
-      current->next = current->next->next;
+      // readers hold the lock too, so nobody else can be looking at the node
+      CoarseGrainNode<T> *node = current->next;
+      current->next = node->next;
+      Allocator::delete_node(node);
+      // current stays in the list, it can be the finger of this thread again
+      removals++;
+      save_finger(current);
+      key_count.store(key_count.load(memory_order_relaxed) - 1,
+                      memory_order_relaxed);
       return true;
     }
 
+    save_finger(current);
     return false;
   }
 
   bool find(const T search_key) {
-    lock_guard<mutex> lock(list_mutex);
-    auto current = head->next;
+    shared_lock<shared_mutex> lock(list_mutex);
+    CoarseGrainNode<T> *before =
+        find_before(finger_start(search_key), search_key);
+    save_finger(before);
+    CoarseGrainNode<T> *current = before->next;
+    return current != tail && current->key == search_key;
+  }
 
-    while (current != tail) {
-      if (current->key == search_key) {
-        return true;
+  /**
+   * @brief Let insert(), remove() and find() start from the node the calling
+   * thread's previous operation stopped before, when it's before the key,
+   * instead of from the head (see finger.h). Off by default
+   * @note Must be set before the list is shared between threads
+   */
+  void enable_finger(bool enabled) { finger_enabled = enabled; }
+
+  /**
+   * @brief Insert a sorted range of keys under a single lock acquisition, in
+   * a single pass over the list
+   *
+   * @param first Iterator to the first key, in ascending order for a single
+   * pass. A key that isn't after the previous one restarts from the head
+   * @param last Iterator past the last key
+   * @return size_t Number of keys that were inserted
+   */
+  template <typename Iterator>
+  size_t insert_batch(Iterator first, Iterator last) {
+    lock_guard<shared_mutex> lock(list_mutex);
+    CoarseGrainNode<T> *current = head;
+    size_t count = 0;
+
+    for (; first != last; ++first) {
+      const T &key = *first;
+      // continue from where the previous key stopped, if it's before this one
+      current = find_before(batch_start(current, key), key);
+      if (current->next != tail && current->next->key == key) {
+        continue;
+      }
+
+      CoarseGrainNode<T> *new_node = Allocator::new_node(key);
+      new_node->next = current->next;
+      current->next = new_node;
+      count++;
+    }
+    key_count.store(key_count.load(memory_order_relaxed) + count,
+                    memory_order_relaxed);
+
+    return count;
+  }
+
+  /**
+   * @brief Remove a sorted range of keys under a single lock acquisition, in
+   * a single pass over the list
+   *
+   * @param first Iterator to the first key, in ascending order for a single
+   * pass. A key that isn't after the previous one restarts from the head
+   * @param last Iterator past the last key
+   * @return size_t Number of keys that were removed
+   */
+  template <typename Iterator>
+  size_t remove_batch(Iterator first, Iterator last) {
+    lock_guard<shared_mutex> lock(list_mutex);
+    CoarseGrainNode<T> *current = head;
+    size_t count = 0;
+
+    for (; first != last; ++first) {
+      const T &key = *first;
+      current = find_before(batch_start(current, key), key);
+      if (current->next != tail && current->next->key == key) {
+        CoarseGrainNode<T> *node = current->next;
+        current->next = node->next;
+        Allocator::delete_node(node);
+        removals++;
+        count++;
       }
+    }
+    key_count.store(key_count.load(memory_order_relaxed) - count,
+                    memory_order_relaxed);
+
+    return count;
+  }
+
+  /**
+   * @brief Visit every key in [lo, hi] in ascending order. The lock is shared
+   * for the whole scan, so the keys visited are a snapshot of the list
+   *
+   * @param lo Smallest key to visit
+   * @param hi Largest key to visit
+   * @param visit Called with each key, as visit(const T &)
+   */
+  template <typename Visitor>
+  void for_each_in_range(const T lo, const T hi, Visitor visit) {
+    shared_lock<shared_mutex> lock(list_mutex);
+    CoarseGrainNode<T> *current = find_before(head, lo)->next;
+
+    while (current != tail && !(hi < current->key)) {
+      visit(current->key);
       current = current->next;
     }
+  }
 
-    return false;
+  /**
+   * @brief Collect every key in [lo, hi] in ascending order
+   *
+   * @param lo Smallest key to collect
+   * @param hi Largest key to collect
+   * @param out The keys are appended to it
+   * @return size_t Number of keys appended
+   */
+  size_t range_query(const T lo, const T hi, vector<T> &out) {
+    size_t size = out.size();
+    for_each_in_range(lo, hi, [&out](const T &key) { out.push_back(key); });
+    return out.size() - size;
   }
 
+  /**
+   * @brief Number of keys in the list, without taking the lock
+   * @note With a single counter written under the lock, the exact count is
+   * as cheap as an estimate, approximate_size() is there so that every list
+   * has the same interface
+   */
+  size_t size() const { return key_count.load(memory_order_relaxed); }
+  size_t approximate_size() const { return size(); }
+
   void print_list() {
-    auto current = head->next;
+    CoarseGrainNode<T> *current = head->next;
 
     while (current != tail) {
       cout << current->key << " -> ";
@@ -0,0 +1,165 @@
+"""Compare two benchmark result files and report throughput regressions.
+
+Reads the text, CSV and JSON files the benchmark writes (see
+benchmark_report.h), and the older <name>,<threads>,<value> files such as
+psc_benchmark_results_*.txt. Results are matched by structure, workload and
+thread count. A result regressed if it got worse by more than the threshold
+and, when both files have at least two repetitions of it, if Welch's t-test
+says the difference isn't noise.
+
+Exits with status 1 if any result regressed, so it can gate a change.
+
+    python3 compare_benchmark.py base.json new.json
+    python3 compare_benchmark.py --metric=time psc_benchmark_results_0.txt \
+        psc_benchmark_results_1.txt
+"""
+
+import argparse
+import csv
+import io
+import json
+import math
+import sys
+
+# two-sided 95% critical values of Student's t, by degrees of freedom
+T_CRITICAL = [
+    12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+    2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+    2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042,
+]
+
+
+class Result:
+    """Statistics of one structure, workload and thread count."""
+
+    def __init__(self, median, stddev=0.0, count=1):
+        self.median = median
+        self.stddev = stddev
+        self.count = count
+
+
+def load_text(text):
+    results = {}
+    for line in text.splitlines():
+        fields = line.strip().split(",")
+        if len(fields) != 3:
+            continue
+        structure, _, workload = fields[0].partition("_")
+        try:
+            results[(structure, workload, int(fields[1]))] = Result(
+                float(fields[2]))
+        except ValueError:
+            continue
+    return results
+
+
+def load_csv(text):
+    results = {}
+    metadata = {}
+    for row in csv.DictReader(io.StringIO(text)):
+        key = (row["structure"], row["workload"], int(row["threads"]))
+        results[key] = Result(float(row["ops_per_sec_median"]),
+                              float(row["ops_per_sec_stddev"]),
+                              int(row["repetitions"]))
+        # the same on every row
+        metadata = {field: row[field]
+                    for field in ("host", "compiler", "flags", "commit")}
+    return results, metadata
+
+
+def load_json(text):
+    results = {}
+    document = json.loads(text)
+    for record in document["results"]:
+        ops = record["ops_per_sec"]
+        key = (record["structure"], record["workload"], record["threads"])
+        results[key] = Result(ops["median"], ops["stddev"], ops["repetitions"])
+    return results, document.get("metadata", {})
+
+
+def load_results(path):
+    """Return the results of a file, keyed by (structure, workload, threads),
+    and its metadata, empty for the formats that don't have any."""
+    with open(path) as f:
+        text = f.read()
+    if text.lstrip().startswith("{"):
+        return load_json(text)
+    if text.startswith("structure,"):
+        return load_csv(text)
+    return load_text(text), {}
+
+
+def significant(base, new):
+    """Whether Welch's t-test tells the two means apart at the 95% level.
+    Without two repetitions on each side there's no spread to test against,
+    so any difference counts."""
+    if base.count < 2 or new.count < 2:
+        return True
+    base_var = base.stddev ** 2 / base.count
+    new_var = new.stddev ** 2 / new.count
+    if base_var + new_var == 0:
+        return base.median != new.median
+    t = abs(new.median - base.median) / math.sqrt(base_var + new_var)
+    df = (base_var + new_var) ** 2 / (
+        base_var ** 2 / (base.count - 1) + new_var ** 2 / (new.count - 1))
+    df = max(1, int(df))
+    critical = T_CRITICAL[df - 1] if df <= len(T_CRITICAL) else 1.960
+    return t > critical
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Compare two benchmark result files.")
+    parser.add_argument("base", help="results before the change")
+    parser.add_argument("new", help="results after the change")
+    parser.add_argument("--threshold", type=float, default=0.05,
+                        help="smallest relative change reported as a "
+                        "regression (default 0.05)")
+    parser.add_argument("--metric", choices=["throughput", "time"],
+                        default="throughput",
+                        help="what the values are: ops per second, higher is "
+                        "better, or a time, lower is better (default "
+                        "throughput)")
+    args = parser.parse_args()
+
+    base, base_metadata = load_results(args.base)
+    new, new_metadata = load_results(args.new)
+    for field in ("host", "compiler", "flags", "commit"):
+        if field in base_metadata or field in new_metadata:
+            print("%-9s %s -> %s" % (field, base_metadata.get(field, "?"),
+                                      new_metadata.get(field, "?")))
+
+    print("%-40s %7s %14s %14s %8s  %s" % ("result", "threads", "base", "new",
+                                         "change", ""))
+    regressions = 0
+    improvements = 0
+    for key in sorted(base, key=lambda k: (k[0], k[1], k[2])):
+        if key not in new:
+            continue
+        before, after = base[key], new[key]
+        if before.median == 0:
+            continue
+        change = (after.median - before.median) / before.median
+        # positive when the new result is better
+        gain = change if args.metric == "throughput" else -change
+        verdict = ""
+        if abs(gain) > args.threshold and significant(before, after):
+            if gain < 0:
+                verdict = "REGRESSION"
+                regressions += 1
+            else:
+                verdict = "improvement"
+                improvements += 1
+        print("%-40s %7d %14.0f %14.0f %+7.1f%%  %s" % (
+            key[0] + "_" + key[1], key[2], before.median, after.median,
+            change * 100, verdict))
+
+    missing = len(set(base) ^ set(new))
+    if missing:
+        print("%d results are only in one of the files" % missing)
+    print("%d regressions, %d improvements" % (regressions, improvements))
+    return 1 if regressions else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
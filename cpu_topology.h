@@ -0,0 +1,180 @@
+/**
+ * @file cpu_topology.h
+ * @author Sihan Zhuang (sihanzhu)
+ * @brief This file contains the CPU topology discovery and thread pinning used
+ * by the benchmark, so that threads are placed the same way from one run to
+ * the next instead of wherever the scheduler puts them.
+ * @note The topology is read from /sys on Linux. Elsewhere, or if /sys can't
+ * be read, every hardware thread is assumed to be its own core on a single
+ * socket, and pinning does nothing.
+ */
+
+#ifndef CPU_TOPOLOGY_H
+#define CPU_TOPOLOGY_H
+
+#include <algorithm>
+#include <fstream>
+#include <set>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+using namespace std;
+
+/**
+ * @brief One hardware thread the process is allowed to run on
+ */
+struct CpuInfo {
+  int cpu;
+  int package;
+  int core;
+  /* NUMA node, 0 if unknown */
+  int node;
+  /* index of the hardware thread among the SMT siblings of its core */
+  int smt_index;
+  /* index of the core among the cores of its package */
+  int core_index;
+};
+
+enum PinPolicy {
+  /* leave placement to the scheduler */
+  PIN_NONE,
+  /* fill a core's SMT siblings, then the next core, then the next socket */
+  PIN_COMPACT,
+  /* alternate between sockets one core at a time, SMT siblings once every
+   * core has a thread */
+  PIN_SCATTER,
+  /* one thread per physical core on every socket first, SMT siblings after */
+  PIN_SMT_LAST
+};
+
+/**
+ * @brief Read an integer from a file in /sys
+ *
+ * @return int The value, or fallback if the file can't be read
+ */
+inline int read_sys_int(const string &path, int fallback) {
+  ifstream file(path);
+  int value;
+  if (file >> value) {
+    return value;
+  }
+  return fallback;
+}
+
+/**
+ * @brief Get the hardware threads the process may run on
+ *
+ * @return vector<int> CPU numbers, in ascending order
+ */
+inline vector<int> allowed_cpus() {
+  vector<int> cpus;
+#ifdef __linux__
+  cpu_set_t mask;
+  if (sched_getaffinity(0, sizeof(mask), &mask) == 0) {
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+      if (CPU_ISSET(cpu, &mask))
+        cpus.push_back(cpu);
+    }
+  }
+#endif
+  if (cpus.empty()) {
+    int count = max(1u, thread::hardware_concurrency());
+    for (int cpu = 0; cpu < count; ++cpu)
+      cpus.push_back(cpu);
+  }
+  return cpus;
+}
+
+/**
+ * @brief Get the topology of the hardware threads the process may run on
+ *
+ * @return vector<CpuInfo> One entry per hardware thread, ordered by CPU number
+ */
+inline vector<CpuInfo> read_topology() {
+  vector<CpuInfo> topology;
+  for (int cpu : allowed_cpus()) {
+    string dir = "/sys/devices/system/cpu/cpu" + to_string(cpu);
+    CpuInfo info;
+    info.cpu = cpu;
+    info.package = read_sys_int(dir + "/topology/physical_package_id", 0);
+    info.core = read_sys_int(dir + "/topology/core_id", cpu);
+    info.node = 0;
+    for (int node = 0; node < 64; ++node) {
+      if (ifstream(dir + "/node" + to_string(node) + "/cpulist")) {
+        info.node = node;
+        break;
+      }
+    }
+    topology.push_back(info);
+  }
+
+  // number the siblings of each core and the cores of each package, in CPU
+  // order
+  for (auto &info : topology) {
+    set<int> cores;
+    info.smt_index = 0;
+    for (const auto &other : topology) {
+      if (other.package != info.package)
+        continue;
+      if (other.core < info.core)
+        cores.insert(other.core);
+      if (other.core == info.core && other.cpu < info.cpu)
+        info.smt_index++;
+    }
+    info.core_index = static_cast<int>(cores.size());
+  }
+  return topology;
+}
+
+/**
+ * @brief Order in which the worker threads are given hardware threads
+ *
+ * @param topology Hardware threads available
+ * @param policy Pinning policy, must not be PIN_NONE
+ * @return vector<int> CPU numbers, worker i is pinned to entry i modulo the
+ * number of entries
+ */
+inline vector<int> pinning_order(vector<CpuInfo> topology, PinPolicy policy) {
+  sort(topology.begin(), topology.end(),
+       [policy](const CpuInfo &a, const CpuInfo &b) {
+         if (policy == PIN_COMPACT) {
+           return make_tuple(a.package, a.core_index, a.smt_index) <
+                  make_tuple(b.package, b.core_index, b.smt_index);
+         }
+         if (policy == PIN_SCATTER) {
+           return make_tuple(a.smt_index, a.core_index, a.package) <
+                  make_tuple(b.smt_index, b.core_index, b.package);
+         }
+         return make_tuple(a.smt_index, a.package, a.core_index) <
+                make_tuple(b.smt_index, b.package, b.core_index);
+       });
+  vector<int> order;
+  for (const auto &info : topology)
+    order.push_back(info.cpu);
+  return order;
+}
+
+/**
+ * @brief Pin the calling thread to one hardware thread
+ *
+ * @param cpu CPU number
+ * @return true If the thread was pinned
+ */
+inline bool pin_this_thread(int cpu) {
+#ifdef __linux__
+  cpu_set_t mask;
+  CPU_ZERO(&mask);
+  CPU_SET(cpu, &mask);
+  return pthread_setaffinity_np(pthread_self(), sizeof(mask), &mask) == 0;
+#else
+  (void)cpu;
+  return false;
+#endif
+}
+
+#endif // CPU_TOPOLOGY_H
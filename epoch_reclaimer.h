@@ -0,0 +1,388 @@
+/**
+ * @file epoch_reclaimer.h
+ * @author Sihan Zhuang (sihanzhu)
+ * @brief This file contains an epoch-based reclamation (EBR) manager. It has
+ * the same interface as HazardPointer so that the lock-free data structures
+ * can take either one as their reclamation policy.
+ */
+
+#ifndef EPOCH_RECLAIMER_H
+#define EPOCH_RECLAIMER_H
+
+#include "list_stats.h"
+#include "node_pool.h"
+#include <array>
+#include <atomic>
+#include <list>
+#include <mutex>
+#include <utility>
+#include <vector>
+using namespace std;
+
+/**
+ * @brief A class to manage epoch-based reclamation for lock-free data
+ * structures
+ *
+ * A thread announces the global epoch when it enters an operation (critical
+ * section) and clears the announcement when it leaves. The global epoch can
+ * only move forward once every thread inside a critical section has announced
+ * the current epoch, so a node retired in epoch e can't be referenced by
+ * anyone once the global epoch has reached e + 2. Unlike hazard pointers,
+ * nothing has to be published per node: the cost is paid once per operation.
+ *
+ * Each thread claims a record the first time it uses the manager and gives it
+ * back when it exits, for the next thread to reuse. The nodes it retired but
+ * didn't free yet are left to the others.
+ *
+ * @note A thread that stalls inside a critical section stops the epoch from
+ * advancing, so memory is only bounded as long as operations finish.
+ * @tparam T Type of the data structure
+ * @tparam Alloc Allocator the retired nodes are given back to
+ */
+template <typename T, typename Alloc = HeapAllocator<T>>
+class EpochReclaimer {
+private:
+  static constexpr int NUM_EPOCHS = 3;
+  /* number of retired nodes between two attempts to advance the epoch */
+  static constexpr size_t ADVANCE_THRESHOLD = 64;
+
+  struct EpochRec {
+    /* whether a thread holds the record */
+    atomic<bool> active;
+    /* (announced epoch << 1) | 1 while in a critical section, 0 otherwise */
+    atomic<unsigned long> state;
+    /* records are only ever prepended to rec_list, so next is set before the
+     * record is published and never changes afterwards */
+    EpochRec *next;
+
+    /* the fields below are only touched by the thread holding the record */
+    int nesting;
+    size_t retired_since_advance;
+    array<vector<T *>, NUM_EPOCHS> limbo;
+    array<unsigned long, NUM_EPOCHS> limbo_epoch;
+
+    EpochRec()
+        : active(true), state(0), next(nullptr), nesting(0),
+          retired_since_advance(0) {
+      limbo_epoch.fill(0);
+    }
+  };
+
+  /* every record ever allocated. A thread gives its record back when it
+   * exits and the next thread to register reuses it, so the list only grows
+   * with the number of threads registered at the same time */
+  atomic<EpochRec *> rec_list{nullptr};
+  atomic<int> num_recs{0};
+  atomic<unsigned long> global_epoch{0};
+
+  /* limbo lists of threads that exited before their nodes could be freed,
+   * with the epoch they were retired in. Freed by the threads that are still
+   * retiring nodes, once the epoch is far enough ahead */
+  struct OrphanBatch {
+    unsigned long epoch;
+    vector<T *> nodes;
+  };
+  mutex orphan_lock;
+  vector<OrphanBatch> orphans;
+  atomic<size_t> num_orphans{0};
+
+  /**
+   * @brief Records of a thread, one per manager it used. They are released
+   * when the thread exits, which gives the records back and hands their
+   * limbo lists to the managers' orphans
+   */
+  struct ThreadRegistrations {
+    list<pair<EpochReclaimer *, EpochRec *>> registrations;
+
+    ~ThreadRegistrations() {
+      for (auto &registration : registrations)
+        registration.first->release(registration.second);
+    }
+  };
+
+  static ThreadRegistrations &local_registrations() {
+    static thread_local ThreadRegistrations registrations;
+    return registrations;
+  }
+
+  /* record of the calling thread with the manager it used last. It's
+   * trivially destructible, so reading it on every enter() costs no TLS
+   * initialization check */
+  struct LocalRec {
+    EpochReclaimer *owner;
+    EpochRec *rec;
+  };
+  static thread_local LocalRec local_rec;
+
+  /* retired and freed nodes, only counted with LIST_STATS */
+  StatCounters stats;
+
+  /**
+   * @brief Function to get the calling thread's epoch record, registering it
+   * the first time it uses this manager
+   *
+   * @return EpochRec* Pointer to the epoch record
+   */
+  EpochRec *acquire_rec() {
+    if (local_rec.owner == this) {
+      return local_rec.rec;
+    }
+    EpochRec *rec = nullptr;
+    for (auto &registration : local_registrations().registrations) {
+      if (registration.first == this) {
+        rec = registration.second;
+      }
+    }
+    if (rec == nullptr) {
+      rec = claim_rec();
+      local_registrations().registrations.push_back({this, rec});
+    }
+    local_rec.owner = this;
+    local_rec.rec = rec;
+    return rec;
+  }
+
+  /**
+   * @brief Function to claim an epoch record, an idle one if there is one and
+   * a new one otherwise
+   *
+   * @return EpochRec* Pointer to the epoch record
+   */
+  EpochRec *claim_rec() {
+    for (EpochRec *rec = rec_list.load(); rec != nullptr; rec = rec->next) {
+      bool idle = false;
+      if (!rec->active.load(memory_order_relaxed) &&
+          rec->active.compare_exchange_strong(idle, true)) {
+        return rec;
+      }
+    }
+    EpochRec *rec = new EpochRec();
+    rec->next = rec_list.load();
+    while (!rec_list.compare_exchange_weak(rec->next, rec)) {
+    }
+    num_recs.fetch_add(1);
+    return rec;
+  }
+
+  /**
+   * @brief Give back the record of an exiting thread, and hand the nodes it
+   * retired but didn't free yet to the orphans
+   *
+   * @param rec The exiting thread's record with this manager
+   */
+  void release(EpochRec *rec) {
+    rec->state.store(0);
+    rec->nesting = 0;
+    rec->retired_since_advance = 0;
+    {
+      lock_guard<mutex> guard(orphan_lock);
+      for (int i = 0; i < NUM_EPOCHS; ++i) {
+        if (!rec->limbo[i].empty()) {
+          orphans.push_back({rec->limbo_epoch[i], move(rec->limbo[i])});
+          rec->limbo[i].clear();
+        }
+      }
+      num_orphans.store(orphans.size(), memory_order_relaxed);
+    }
+    rec->active.store(false, memory_order_release);
+    if (local_rec.rec == rec) {
+      local_rec.owner = nullptr;
+    }
+  }
+
+  /**
+   * @brief Move the global epoch forward if every thread inside a critical
+   * section has announced the current one
+   */
+  void try_advance() {
+    // order the unlinks of the retired nodes before reading the announcements,
+    // the lists may unlink with acq_rel CASes (see memory_ordering.h)
+    atomic_thread_fence(memory_order_seq_cst);
+    unsigned long epoch = global_epoch.load();
+    // idle records announce nothing, so they can be read like the others
+    for (EpochRec *rec = rec_list.load(); rec != nullptr; rec = rec->next) {
+      unsigned long state = rec->state.load();
+      if ((state & 1) && (state >> 1) != epoch) {
+        return;
+      }
+    }
+    global_epoch.compare_exchange_strong(epoch, epoch + 1);
+  }
+
+  /**
+   * @brief Free the nodes of every limbo list that is at least two epochs old
+   *
+   * @param rec The calling thread's epoch record
+   */
+  void reclaim(EpochRec *rec) {
+    unsigned long epoch = global_epoch.load();
+    for (int i = 0; i < NUM_EPOCHS; ++i) {
+      if (!rec->limbo[i].empty() && rec->limbo_epoch[i] + 2 <= epoch) {
+        for (auto node : rec->limbo[i])
+          Alloc::delete_node(node);
+        stats.add(STAT_NODES_FREED, rec->limbo[i].size());
+        rec->limbo[i].clear();
+      }
+    }
+    if (num_orphans.load(memory_order_relaxed) == 0) {
+      return;
+    }
+    lock_guard<mutex> guard(orphan_lock);
+    size_t kept = 0;
+    for (size_t i = 0; i < orphans.size(); ++i) {
+      if (orphans[i].epoch + 2 <= epoch) {
+        for (auto node : orphans[i].nodes)
+          Alloc::delete_node(node);
+        stats.add(STAT_NODES_FREED, orphans[i].nodes.size());
+      } else {
+        // moving a vector onto itself empties it
+        if (kept != i)
+          orphans[kept] = move(orphans[i]);
+        kept++;
+      }
+    }
+    orphans.resize(kept);
+    num_orphans.store(kept, memory_order_relaxed);
+  }
+
+public:
+  /* whether every node has to be published with protect() before it's used */
+  static constexpr bool protects_per_node = false;
+
+  /**
+   * @brief Free whatever is left in the limbo lists and the orphans, and the
+   * records. No thread can be inside a critical section anymore
+   * @note The manager must outlive the threads that used it, which the
+   * static managers of the lists do
+   */
+  ~EpochReclaimer() {
+    for (auto &batch : orphans)
+      for (auto node : batch.nodes)
+        Alloc::delete_node(node);
+    EpochRec *rec = rec_list.load();
+    while (rec != nullptr) {
+      for (auto &nodes : rec->limbo)
+        for (auto node : nodes)
+          Alloc::delete_node(node);
+      EpochRec *next = rec->next;
+      delete rec;
+      rec = next;
+    }
+  }
+
+  /**
+   * @brief Scope of one operation on the data structure. Entering announces
+   * the current epoch and leaving clears it. Guards can be nested, only the
+   * outermost one announces
+   */
+  class Guard {
+  private:
+    EpochReclaimer &manager;
+
+  public:
+    Guard(EpochReclaimer &manager) : manager(manager) { manager.enter(); }
+    ~Guard() { manager.leave(); }
+  };
+
+  void enter() {
+    EpochRec *rec = acquire_rec();
+    if (rec->nesting++ == 0) {
+      rec->state.store((global_epoch.load() << 1) | 1, memory_order_relaxed);
+      // the announcement must be visible before any node is read, which an
+      // acquire load in the list doesn't guarantee on its own
+      atomic_thread_fence(memory_order_seq_cst);
+    }
+  }
+
+  void leave() {
+    EpochRec *rec = acquire_rec();
+    if (--rec->nesting == 0) {
+      rec->state.store(0);
+    }
+  }
+
+  /* nodes are protected by the critical section, not one by one */
+  T *get_protected(int) { return nullptr; }
+  void protect(T *, int) {}
+  void clear(int) {}
+
+  /**
+   * @brief Check if the calling thread may dereference nodes it reached
+   *
+   * @return true If the calling thread is inside a critical section
+   */
+  bool is_protected(T *) { return acquire_rec()->nesting > 0; }
+
+  /**
+   * @brief Get a stamp that tells whether a node the calling thread reached
+   * in this critical section may have been freed by a later one
+   *
+   * A node reachable in the epoch the calling thread announced is retired in
+   * that epoch or a later one, and only freed once the global epoch is two
+   * epochs ahead. A later critical section that announces the same epoch
+   * keeps the global epoch from getting there, so the node is still safe to
+   * use in it.
+   *
+   * @return unsigned long The epoch announced by the calling thread
+   */
+  unsigned long pin_finger(T *) {
+    return acquire_rec()->state.load(memory_order_relaxed) >> 1;
+  }
+
+  /**
+   * @brief Check if a node pinned in an earlier critical section is still safe
+   * to use in the current one
+   *
+   * @param stamp Returned by pin_finger()
+   * @return true If the calling thread announced the same epoch again
+   * @note enter() may announce an epoch the global epoch has already left, so
+   * the global epoch is checked too: once it's read after the announcement,
+   * it can't get two epochs ahead of it anymore
+   */
+  bool finger_pinned(T *, unsigned long stamp) {
+    return (acquire_rec()->state.load(memory_order_relaxed) >> 1) == stamp &&
+           global_epoch.load() <= stamp + 1;
+  }
+
+  const StatCounters &get_stats() const { return stats; }
+
+  /**
+   * @brief Number of records allocated, the largest number of threads that
+   * were registered at the same time
+   */
+  int num_records() const { return num_recs.load(); }
+
+  /**
+   * @brief Retire a node and free the memory once no thread can reach it
+   *
+   * @param ptr Pointer to the node to be retired
+   */
+  void retire_node(T *ptr) {
+    EpochRec *rec = acquire_rec();
+    unsigned long epoch = global_epoch.load();
+    int index = epoch % NUM_EPOCHS;
+
+    // the list for this slot was filled at least NUM_EPOCHS epochs ago
+    if (rec->limbo_epoch[index] != epoch) {
+      for (auto node : rec->limbo[index])
+        Alloc::delete_node(node);
+      stats.add(STAT_NODES_FREED, rec->limbo[index].size());
+      rec->limbo[index].clear();
+      rec->limbo_epoch[index] = epoch;
+    }
+    rec->limbo[index].push_back(ptr);
+    stats.add(STAT_NODES_RETIRED);
+
+    if (++rec->retired_since_advance >= ADVANCE_THRESHOLD) {
+      rec->retired_since_advance = 0;
+      try_advance();
+      reclaim(rec);
+    }
+  }
+};
+
+template <typename T, typename Alloc>
+thread_local typename EpochReclaimer<T, Alloc>::LocalRec
+    EpochReclaimer<T, Alloc>::local_rec = {nullptr, nullptr};
+
+#endif // EPOCH_RECLAIMER_H
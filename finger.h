@@ -0,0 +1,47 @@
+/**
+ * @file finger.h
+ * @author Sihan Zhuang (sihanzhu)
+ * @brief This file contains the per-thread search finger of the lists. With
+ * the finger enabled, an operation remembers the node it stopped before, and
+ * the next operation of the same thread starts from that node instead of the
+ * head if its key is larger. Runs of increasing or clustered keys then cost a
+ * few hops per operation instead of a walk from the head.
+ * @note The finger is only a hint. Before it's used, the list checks that the
+ * node can't have been freed since (see pin_finger() in the reclamation
+ * policies) and that it isn't marked, and starts from the head otherwise.
+ */
+
+#ifndef FINGER_H
+#define FINGER_H
+
+#include <atomic>
+#include <cstdint>
+using namespace std;
+
+/**
+ * @brief Get an ID that no other list object has had. A finger guarded by the
+ * address of its list could be picked up by a new list allocated where a
+ * destroyed one used to be
+ *
+ * @return uint64_t The ID, never 0
+ */
+inline uint64_t next_list_id() {
+  static atomic<uint64_t> last_id{0};
+  return last_id.fetch_add(1, memory_order_relaxed) + 1;
+}
+
+/**
+ * @brief Node a thread last stopped before in a list
+ *
+ * @tparam Node Type of the nodes of the list
+ */
+template <typename Node> struct Finger {
+  /* list the node is from, 0 if the finger was never set */
+  uint64_t list_id = 0;
+  Node *node = nullptr;
+  /* tells whether the node may have been freed since, its meaning depends on
+   * the list and its reclamation policy */
+  unsigned long stamp = 0;
+};
+
+#endif // FINGER_H
@@ -0,0 +1,331 @@
+/**
+ * @file flat_combining_list.h
+ * @author Sihan Zhuang (sihanzhu)
+ * @brief This file contains a sorted linked list that uses flat combining
+ * (Hendler et al., SPAA 2010) instead of handing a lock from thread to thread.
+ * A thread publishes its insert, remove or find in a slot of its own, and
+ * whichever thread gets the combiner lock applies every pending request in a
+ * single sorted pass over the list, the same way insert_batch() of
+ * CoarseGrainList does. The list and the lock's cache line then stay with
+ * the combiner, and the other threads only spin on their own slot.
+ * @note Nodes are plain pointers, as in CoarseGrainList: only the combiner
+ * ever touches them.
+ */
+
+#ifndef FLAT_COMBINING_LIST_H
+#define FLAT_COMBINING_LIST_H
+
+#include "backoff.h"
+#include "node_pool.h"
+#include "sharded_counter.h"
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <thread>
+#include <vector>
+using namespace std;
+
+template <typename T> struct FlatCombiningNode {
+  T key;
+  /* owned by the list, only changed by the combiner */
+  FlatCombiningNode<T> *next;
+  FlatCombiningNode(const T &key) : key(key), next(nullptr) {}
+  FlatCombiningNode() : next(nullptr) {}
+};
+
+/**
+ * @brief A sorted linked list whose operations are applied in batches by a
+ * single combining thread at a time
+ *
+ * @tparam T Type of the keys
+ * @tparam Alloc Node allocator, either HeapAllocator or NodePool
+ */
+template <typename T, template <typename> class Alloc = HeapAllocator>
+class FlatCombiningList {
+private:
+  typedef Alloc<FlatCombiningNode<T>> Allocator;
+
+  /* number of publication slots. A thread keeps using the same slot, and
+   * moves to the next free one while another thread has it */
+  static constexpr unsigned NUM_SLOTS = 128;
+
+  enum Operation { OP_INSERT, OP_REMOVE, OP_FIND };
+
+  enum SlotState {
+    /* nobody is using the slot */
+    SLOT_FREE,
+    /* a thread owns the slot and is writing its request */
+    SLOT_CLAIMED,
+    /* the request is waiting for a combiner */
+    SLOT_PENDING,
+    /* the combiner applied the request and wrote its result */
+    SLOT_DONE
+  };
+
+  /* one cache line each, so that a thread spinning on its slot doesn't
+   * bounce the line of its neighbours */
+  struct alignas(CACHE_LINE_SIZE) Slot {
+    atomic<int> state{SLOT_FREE};
+    /* written by the owner before the request is published */
+    Operation op = OP_FIND;
+    T key{};
+    /* written by the combiner before the request is done */
+    bool result = false;
+  };
+
+  /* a pending request, as collected by the combiner */
+  struct Request {
+    T key;
+    Operation op;
+    unsigned slot;
+  };
+
+  // sentinel nodes
+  FlatCombiningNode<T> *head;
+  FlatCombiningNode<T> *tail;
+  /* only written by the combiner, atomic so that size() can read it without
+   * the combiner lock */
+  atomic<size_t> key_count{0};
+  /* the requests of the current pass, only used by the combiner */
+  vector<Request> batch;
+
+  alignas(CACHE_LINE_SIZE) atomic<bool> combining{false};
+  /* past the highest slot ever claimed, so that the combiner doesn't scan the
+   * slots of threads that never used the list */
+  alignas(CACHE_LINE_SIZE) atomic<unsigned> slot_limit{0};
+  Slot slots[NUM_SLOTS];
+
+  /**
+   * @brief Slot the calling thread tries first. Threads get consecutive slots
+   * in the order they first use a list of this type
+   */
+  static unsigned preferred_slot() {
+    static atomic<unsigned> next_thread{0};
+    static thread_local unsigned slot =
+        next_thread.fetch_add(1, memory_order_relaxed) % NUM_SLOTS;
+    return slot;
+  }
+
+  /**
+   * @brief Take a free slot for the calling thread's request, starting from
+   * its preferred one
+   */
+  Slot &claim_slot() {
+    unsigned index = preferred_slot();
+    for (unsigned tries = 1;; ++tries) {
+      Slot &slot = slots[index];
+      int expected = SLOT_FREE;
+      if (slot.state.load(memory_order_relaxed) == SLOT_FREE &&
+          slot.state.compare_exchange_strong(expected, SLOT_CLAIMED,
+                                             memory_order_acquire)) {
+        raise_slot_limit(index + 1);
+        return slot;
+      }
+      index = (index + 1) % NUM_SLOTS;
+      // every slot is taken, wait for one of the requests to complete
+      if (tries % NUM_SLOTS == 0) {
+        this_thread::yield();
+      }
+    }
+  }
+
+  void raise_slot_limit(unsigned limit) {
+    unsigned current = slot_limit.load(memory_order_relaxed);
+    while (current < limit &&
+           !slot_limit.compare_exchange_weak(current, limit,
+                                             memory_order_relaxed)) {
+    }
+  }
+
+  bool try_lock_combiner() {
+    return !combining.load(memory_order_relaxed) &&
+           !combining.exchange(true, memory_order_acquire);
+  }
+
+  void lock_combiner() {
+    for (int spins = 1; !try_lock_combiner(); ++spins) {
+      if (spins % 64 == 0) {
+        this_thread::yield();
+      } else {
+        cpu_relax();
+      }
+    }
+  }
+
+  void unlock_combiner() { combining.store(false, memory_order_release); }
+
+  /**
+   * @brief Find the last node whose key is less than key, starting from
+   * current
+   * @note The combiner lock must be held
+   */
+  FlatCombiningNode<T> *find_before(FlatCombiningNode<T> *current,
+                                    const T &key) const {
+    while (current->next != tail && current->next->key < key) {
+      current = current->next;
+    }
+    return current;
+  }
+
+  /**
+   * @brief Apply every pending request in a single pass over the list
+   * @note The combiner lock must be held
+   */
+  void combine() {
+    // a slot claimed after this load is combined by its owner or the next
+    // combiner, its owner keeps trying the lock until it's done
+    unsigned limit = slot_limit.load(memory_order_relaxed);
+    batch.clear();
+    for (unsigned i = 0; i < limit; ++i) {
+      if (slots[i].state.load(memory_order_acquire) == SLOT_PENDING) {
+        batch.push_back({slots[i].key, slots[i].op, i});
+      }
+    }
+    // requests on the same key are applied in slot order, any order is a
+    // valid linearization of concurrent operations
+    sort(batch.begin(), batch.end(), [](const Request &a, const Request &b) {
+      return a.key < b.key || (!(b.key < a.key) && a.slot < b.slot);
+    });
+
+    FlatCombiningNode<T> *current = head;
+    size_t count = key_count.load(memory_order_relaxed);
+    for (const Request &request : batch) {
+      // the previous key is before this one, continue from where it stopped
+      current = find_before(current, request.key);
+      bool present =
+          current->next != tail && current->next->key == request.key;
+      bool result = present;
+      if (request.op == OP_INSERT) {
+        if (!present) {
+          FlatCombiningNode<T> *new_node = Allocator::new_node(request.key);
+          new_node->next = current->next;
+          current->next = new_node;
+          count++;
+        }
+        result = !present;
+      } else if (request.op == OP_REMOVE && present) {
+        FlatCombiningNode<T> *node = current->next;
+        current->next = node->next;
+        Allocator::delete_node(node);
+        count--;
+      }
+
+      Slot &slot = slots[request.slot];
+      slot.result = result;
+      // the owner may reuse the slot from here on, it's not in the batch twice
+      slot.state.store(SLOT_DONE, memory_order_release);
+    }
+    key_count.store(count, memory_order_relaxed);
+  }
+
+  /**
+   * @brief Publish a request and wait for a combiner to apply it, becoming
+   * the combiner whenever the lock is free
+   */
+  bool apply(Operation op, const T &key) {
+    Slot &slot = claim_slot();
+    slot.op = op;
+    slot.key = key;
+    slot.state.store(SLOT_PENDING, memory_order_release);
+
+    for (int spins = 1; slot.state.load(memory_order_acquire) != SLOT_DONE;
+         ++spins) {
+      if (try_lock_combiner()) {
+        combine();
+        unlock_combiner();
+      } else if (spins % 64 == 0) {
+        // the combiner may be waiting for this core
+        this_thread::yield();
+      } else {
+        cpu_relax();
+      }
+    }
+
+    bool result = slot.result;
+    slot.state.store(SLOT_FREE, memory_order_release);
+    return result;
+  }
+
+public:
+  FlatCombiningList() {
+    head = Allocator::new_node();
+    tail = Allocator::new_node();
+    head->next = tail;
+    batch.reserve(NUM_SLOTS);
+  }
+
+  /**
+   * @brief Destroy the Flat Combining List object, one node at a time so
+   * that a long list can't overflow the stack
+   */
+  ~FlatCombiningList() {
+    FlatCombiningNode<T> *current = head;
+    while (current != nullptr) {
+      FlatCombiningNode<T> *next = current->next;
+      Allocator::delete_node(current);
+      current = next;
+    }
+  }
+
+  FlatCombiningList(const FlatCombiningList &) = delete;
+  FlatCombiningList &operator=(const FlatCombiningList &) = delete;
+
+  bool insert(const T key) { return apply(OP_INSERT, key); }
+
+  bool remove(const T key) { return apply(OP_REMOVE, key); }
+
+  bool find(const T search_key) { return apply(OP_FIND, search_key); }
+
+  /**
+   * @brief Visit every key in [lo, hi] in ascending order. The scan holds the
+   * combiner lock, so the keys visited are a snapshot of the list, and no
+   * request is applied until it's done
+   *
+   * @param lo Smallest key to visit
+   * @param hi Largest key to visit
+   * @param visit Called with each key, as visit(const T &)
+   */
+  template <typename Visitor>
+  void for_each_in_range(const T lo, const T hi, Visitor visit) {
+    lock_combiner();
+    FlatCombiningNode<T> *current = find_before(head, lo)->next;
+
+    while (current != tail && !(hi < current->key)) {
+      visit(current->key);
+      current = current->next;
+    }
+    unlock_combiner();
+  }
+
+  /**
+   * @brief Collect every key in [lo, hi] in ascending order
+   *
+   * @param lo Smallest key to collect
+   * @param hi Largest key to collect
+   * @param out The keys are appended to it
+   * @return size_t Number of keys appended
+   */
+  size_t range_query(const T lo, const T hi, vector<T> &out) {
+    size_t size = out.size();
+    for_each_in_range(lo, hi, [&out](const T &key) { out.push_back(key); });
+    return out.size() - size;
+  }
+
+  /**
+   * @brief Number of keys in the list, as of the latest combining pass
+   */
+  size_t size() const { return key_count.load(memory_order_relaxed); }
+  size_t approximate_size() const { return size(); }
+
+  void print_list() {
+    FlatCombiningNode<T> *current = head->next;
+
+    while (current != tail) {
+      cout << current->key << " -> ";
+      current = current->next;
+    }
+    cout << "NULL\n";
+  }
+};
+
+#endif // FLAT_COMBINING_LIST_H
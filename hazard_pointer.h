@@ -0,0 +1,411 @@
+/**
+ * @file hazard_pointer.h
+ * @author Sihan Zhuang (sihanzhu)
+ * @brief This file contains the hazard pointer manager used to reclaim the
+ * memory of nodes removed from the lock-free data structures.
+ */
+
+#ifndef HAZARD_POINTER_H
+#define HAZARD_POINTER_H
+
+#include "list_stats.h"
+#include "node_pool.h"
+#include "sharded_counter.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <list>
+#include <mutex>
+#include <vector>
+using namespace std;
+
+/**
+ * @brief A class to manage hazard pointers for lock-free data structures
+ *
+ * We use an array of hazard pointers for each thread. Each thread can have
+ * up to HP_PER_THREAD hazard pointers. Pointers stored in the array are
+ * protected from being deleted. When a thread no longer need the reference to a
+ * node, we can safely replace the pointer (stored in a specific index) with the
+ * next one. The hazard pointers are used to protect nodes from being deleted
+ * while they are still being accessed by other threads. Each thread claims a
+ * record the first time it uses the manager and caches it in a thread_local,
+ * so publishing a hazard pointer afterwards is a single store. The record is
+ * given back when the thread exits, for the next thread to reuse, and the
+ * nodes the thread retired but didn't free yet are left to the others.
+ *
+ * @tparam T Type of the data structure
+ * @tparam Alloc Allocator the retired nodes are given back to
+ * @tparam CacheAligned Give every thread's record a cache line of its own.
+ * Otherwise records are packed, and a protect() store invalidates the line
+ * holding the neighbouring threads' hazard pointers as well
+ */
+template <typename T, typename Alloc, bool CacheAligned>
+class BasicHazardPointer {
+private:
+  /* with CacheAligned, every record and num_recs start a cache line, so the
+   * manager itself is aligned and padded to whole lines and doesn't share
+   * them with the data around it either */
+  static constexpr size_t LAYOUT_ALIGNMENT =
+      CacheAligned ? CACHE_LINE_SIZE : alignof(atomic<T *>);
+
+  static constexpr int HP_PER_THREAD = 5;
+  /* kept across operations by pin_finger(), Guard doesn't clear it */
+  static constexpr int FINGER_HP = HP_PER_THREAD - 1;
+
+  struct alignas(LAYOUT_ALIGNMENT) HPRec {
+    array<atomic<T *>, HP_PER_THREAD> hp;
+    /* whether a thread holds the record */
+    atomic<bool> active;
+    /* records are only ever prepended to hp_list, so next is set before the
+     * record is published and never changes afterwards */
+    HPRec *next;
+
+    HPRec() : active(true), next(nullptr) {
+      for (auto &h : hp)
+        h.store(nullptr);
+    }
+  };
+
+  /* every record ever allocated. A thread gives its record back when it
+   * exits and the next thread to register reuses it, so the list only grows
+   * with the number of threads registered at the same time */
+  atomic<HPRec *> hp_list{nullptr};
+  /* length of hp_list. It's read on every retire, so the aligned layout keeps
+   * it off the line of hp_list */
+  alignas(LAYOUT_ALIGNMENT) atomic<int> num_recs{0};
+
+  /* nodes retired by threads that exited before they could free them,
+   * adopted by the next thread that scans */
+  mutex orphan_lock;
+  vector<T *> orphans;
+  atomic<size_t> num_orphans{0};
+
+  /**
+   * @brief A record held by a thread, and the nodes the thread retired to
+   * this manager
+   */
+  struct Registration {
+    BasicHazardPointer *owner;
+    HPRec *rec;
+    vector<T *> retired;
+  };
+
+  /**
+   * @brief Registrations of a thread, one per manager it used. They are
+   * released when the thread exits, which gives the records back and hands
+   * the nodes the thread retired to the managers' orphan lists
+   */
+  struct ThreadRegistrations {
+    list<Registration> registrations;
+
+    ~ThreadRegistrations() {
+      for (auto &registration : registrations)
+        registration.owner->release(registration);
+    }
+  };
+
+  static ThreadRegistrations &local_registrations() {
+    static thread_local ThreadRegistrations registrations;
+    return registrations;
+  }
+
+  /* registration of the calling thread with the manager it used last. It's
+   * trivially destructible, so reading it on every protect() costs no TLS
+   * initialization check */
+  struct LocalRec {
+    BasicHazardPointer *owner;
+    HPRec *rec;
+    Registration *registration;
+  };
+  static thread_local LocalRec local_rec;
+
+  /* retired and freed nodes, only counted with LIST_STATS */
+  StatCounters stats;
+
+  /**
+   * @brief Function to get the calling thread's registration, registering it
+   * the first time it uses this manager
+   *
+   * @return Registration& The registration
+   */
+  Registration &acquire_registration() {
+    if (local_rec.owner == this) {
+      return *local_rec.registration;
+    }
+    Registration *found = nullptr;
+    for (auto &registration : local_registrations().registrations) {
+      if (registration.owner == this) {
+        found = &registration;
+      }
+    }
+    if (found == nullptr) {
+      local_registrations().registrations.push_back(
+          Registration{this, claim_hp_rec(), {}});
+      found = &local_registrations().registrations.back();
+    }
+    local_rec.owner = this;
+    local_rec.rec = found->rec;
+    local_rec.registration = found;
+    return *found;
+  }
+
+  /**
+   * @brief Function to get the calling thread's hazard pointer record
+   *
+   * @return HPRec* Pointer to the hazard pointer record
+   */
+  HPRec *acquire_hp_rec() {
+    if (local_rec.owner == this) {
+      return local_rec.rec;
+    }
+    return acquire_registration().rec;
+  }
+
+  /**
+   * @brief Function to claim a hazard pointer record, an idle one if there is
+   * one and a new one otherwise
+   *
+   * @return HPRec* Pointer to the hazard pointer record
+   */
+  HPRec *claim_hp_rec() {
+    for (HPRec *rec = hp_list.load(); rec != nullptr; rec = rec->next) {
+      bool idle = false;
+      if (!rec->active.load(memory_order_relaxed) &&
+          rec->active.compare_exchange_strong(idle, true)) {
+        return rec;
+      }
+    }
+    HPRec *rec = new HPRec();
+    rec->next = hp_list.load();
+    while (!hp_list.compare_exchange_weak(rec->next, rec)) {
+    }
+    num_recs.fetch_add(1);
+    return rec;
+  }
+
+  /**
+   * @brief Give back the record of an exiting thread. Its hazard pointers are
+   * cleared first, so an idle record protects nothing
+   *
+   * @param registration The exiting thread's registration with this manager
+   * @note The retired nodes aren't scanned here, the scan's thread_local
+   * buffer may already be destroyed
+   */
+  void release(Registration &registration) {
+    for (auto &h : registration.rec->hp)
+      h.store(nullptr, memory_order_release);
+    if (!registration.retired.empty()) {
+      lock_guard<mutex> guard(orphan_lock);
+      orphans.insert(orphans.end(), registration.retired.begin(),
+                     registration.retired.end());
+      num_orphans.store(orphans.size(), memory_order_relaxed);
+      registration.retired.clear();
+    }
+    registration.rec->active.store(false, memory_order_release);
+    if (local_rec.registration == &registration) {
+      local_rec.owner = nullptr;
+    }
+  }
+
+  /**
+   * @brief Move the orphaned nodes into the calling thread's retired nodes, so
+   * that its next scan frees them
+   */
+  void adopt_orphans(vector<T *> &retired_list) {
+    if (num_orphans.load(memory_order_relaxed) == 0) {
+      return;
+    }
+    lock_guard<mutex> guard(orphan_lock);
+    retired_list.insert(retired_list.end(), orphans.begin(), orphans.end());
+    orphans.clear();
+    num_orphans.store(0, memory_order_relaxed);
+  }
+
+  /**
+   * @brief Number of retired nodes a thread collects before scanning
+   *
+   * With H hazard pointers in use, at most H retired nodes can be protected,
+   * so scanning once 2H nodes are retired frees at least half of them and
+   * keeps the amortized cost of a reclamation O(1) per retired node.
+   *
+   * @return size_t The threshold
+   */
+  size_t retire_threshold() {
+    const size_t MIN_DELETION_THRESHOLD = 50;
+    size_t hazards = static_cast<size_t>(num_recs.load()) * HP_PER_THREAD;
+    return max(MIN_DELETION_THRESHOLD, 2 * hazards);
+  }
+
+  /**
+   * @brief Free every node in retired_list that isn't protected
+   *
+   * All the hazard pointers are read once into a sorted snapshot and each
+   * retired node is looked up in the snapshot, instead of walking every
+   * record for every retired node.
+   *
+   * @param retired_list The calling thread's retired nodes
+   */
+  void scan(vector<T *> &retired_list) {
+    static thread_local vector<T *> protected_list;
+    protected_list.clear();
+
+    // the nodes were unlinked before they were retired. Order the unlinks
+    // before reading the hazard pointers, so that a thread that published a
+    // hazard pointer too late sees the unlink when it validates (see
+    // memory_ordering.h)
+    atomic_thread_fence(memory_order_seq_cst);
+    // idle records are cleared before they're given back, so they can be
+    // read like the others
+    for (HPRec *rec = hp_list.load(); rec != nullptr; rec = rec->next) {
+      for (const auto &hp : rec->hp) {
+        T *ptr = hp.load();
+        if (ptr != nullptr)
+          protected_list.push_back(ptr);
+      }
+    }
+    sort(protected_list.begin(), protected_list.end());
+
+    // keep the protected nodes at the front and free the rest
+    size_t kept = 0;
+    for (size_t i = 0; i < retired_list.size(); ++i) {
+      T *node = retired_list[i];
+      if (binary_search(protected_list.begin(), protected_list.end(), node)) {
+        retired_list[kept++] = node;
+      } else {
+        Alloc::delete_node(node);
+      }
+    }
+    stats.add(STAT_NODES_FREED, retired_list.size() - kept);
+    retired_list.resize(kept);
+  }
+
+public:
+  /* whether every node has to be published with protect() before it's used */
+  static constexpr bool protects_per_node = true;
+
+  /**
+   * @brief Free the orphaned nodes and the records
+   * @note The manager must outlive the threads that used it, which the
+   * static managers of the lists do
+   */
+  ~BasicHazardPointer() {
+    for (auto node : orphans)
+      Alloc::delete_node(node);
+    HPRec *rec = hp_list.load();
+    while (rec != nullptr) {
+      HPRec *next = rec->next;
+      delete rec;
+      rec = next;
+    }
+  }
+
+  /**
+   * @brief Scope of one operation on the data structure. Hazard pointers are
+   * published node by node, so there is nothing to do on entry, and the
+   * hazard pointers of the calling thread are cleared on exit so that they
+   * don't keep retired nodes alive. Only the finger's is kept
+   */
+  class Guard {
+  private:
+    BasicHazardPointer &manager;
+
+  public:
+    Guard(BasicHazardPointer &manager) : manager(manager) {}
+    ~Guard() {
+      for (int i = 0; i < HP_PER_THREAD; ++i)
+        if (i != FINGER_HP)
+          manager.clear(i);
+    }
+  };
+
+  /* below are helper functions to get/set states in the array */
+  T *get_protected(int hp_index) {
+    auto rec = acquire_hp_rec();
+    return rec->hp[hp_index].load();
+  }
+
+  /* seq_cst, ordered before the load that validates the node */
+  void protect(T *ptr, int hp_index) {
+    auto rec = acquire_hp_rec();
+    rec->hp[hp_index].store(ptr, memory_order_seq_cst);
+  }
+
+  /* release, the node is no longer read once the hazard pointer is cleared */
+  void clear(int hp_index) {
+    auto rec = acquire_hp_rec();
+    rec->hp[hp_index].store(nullptr, memory_order_release);
+  }
+
+  /**
+   * @brief Keep a node the calling thread holds a hazard pointer to from
+   * being freed after the operation, until another node is pinned
+   *
+   * @param ptr Node to keep, see finger.h
+   * @return unsigned long Stamp to check the node with in finger_pinned()
+   */
+  unsigned long pin_finger(T *ptr) {
+    protect(ptr, FINGER_HP);
+    return 0;
+  }
+
+  /**
+   * @brief Check if a node pinned by the calling thread is still safe to use
+   *
+   * @param ptr Node that was pinned
+   * @return true If the node is still pinned, so it wasn't freed
+   */
+  bool finger_pinned(T *ptr, unsigned long) {
+    return get_protected(FINGER_HP) == ptr;
+  }
+
+  const StatCounters &get_stats() const { return stats; }
+
+  /**
+   * @brief Number of records allocated, the largest number of threads that
+   * were registered at the same time
+   */
+  int num_records() const { return num_recs.load(); }
+
+  bool is_protected(T *ptr) {
+    for (HPRec *rec = hp_list.load(); rec != nullptr; rec = rec->next) {
+      for (const auto &hp : rec->hp) {
+        // found a match, the ptr is protected
+        if (hp.load() == ptr)
+          return true;
+      }
+    }
+    return false;
+  }
+
+  /**
+   * @brief Retire a node and free the memory if possible
+   *
+   * @param ptr Pointer to the node to be retired
+   */
+  void retire_node(T *ptr) {
+    vector<T *> &retired_list = acquire_registration().retired;
+
+    retired_list.push_back(ptr);
+    stats.add(STAT_NODES_RETIRED);
+
+    // Scan and free nodes that are safe to delete
+    if (retired_list.size() >= retire_threshold()) {
+      adopt_orphans(retired_list);
+      scan(retired_list);
+    }
+  }
+};
+
+template <typename T, typename Alloc, bool CacheAligned>
+thread_local typename BasicHazardPointer<T, Alloc, CacheAligned>::LocalRec
+    BasicHazardPointer<T, Alloc, CacheAligned>::local_rec = {
+        nullptr, nullptr, nullptr};
+
+/* the reclamation policies taken by the lock-free data structures, with the
+ * records packed or one per cache line */
+template <typename T, typename Alloc = HeapAllocator<T>>
+using HazardPointer = BasicHazardPointer<T, Alloc, false>;
+template <typename T, typename Alloc = HeapAllocator<T>>
+using PaddedHazardPointer = BasicHazardPointer<T, Alloc, true>;
+
+#endif // HAZARD_POINTER_H
@@ -0,0 +1,223 @@
+/**
+ * @file key_distribution.h
+ * @author Sihan Zhuang (sihanzhu)
+ * @brief This file contains the key generators of the benchmark and the
+ * contention tests. Uniform keys spread the operations over the whole list, so
+ * two threads rarely meet on the same nodes. Real traffic is skewed, and the
+ * threads then keep hitting, and CASing, the same few next pointers.
+ * @note A KeySpace holds what all the threads share (the distribution and its
+ * precomputed constants), and each thread draws its keys from its own
+ * KeyGenerator.
+ */
+
+#ifndef KEY_DISTRIBUTION_H
+#define KEY_DISTRIBUTION_H
+
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+using namespace std;
+
+enum KeyDistribution {
+  /* every key of the range equally often */
+  KEYS_UNIFORM,
+  /* key of rank i with a probability proportional to 1 / i^skew */
+  KEYS_ZIPFIAN,
+  /* most operations on a small, optionally moving, set of keys */
+  KEYS_HOTSPOT,
+  /* writes are uniform, finds look up one of the thread's latest writes */
+  KEYS_READ_YOUR_WRITES,
+  NUM_KEY_DISTRIBUTIONS
+};
+
+/**
+ * @brief Small and fast per-thread random number generator (xorshift64*), so
+ * that generating keys doesn't show up in the measurements
+ */
+class FastRandom {
+private:
+  uint64_t state;
+
+public:
+  FastRandom(uint64_t seed) : state(seed * 0x9E3779B97F4A7C15ULL + 1) {}
+
+  uint64_t next() {
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return state * 0x2545F4914F6CDD1DULL;
+  }
+
+  /**
+   * @brief Uniform double in [0, 1)
+   */
+  double next_unit() { return (next() >> 11) * (1.0 / (1ULL << 53)); }
+};
+
+/**
+ * @brief Distribution of the keys over [0, key_range), shared by the threads
+ */
+class KeySpace {
+public:
+  KeyDistribution distribution;
+  long key_range;
+  /* exponent of the Zipfian distribution, in [0, 1) */
+  double skew;
+  /* number of keys in the hot set, and the share of the operations on it */
+  long hot_keys;
+  int hot_ops_percent;
+
+  /**
+   * @param distribution Shape of the distribution
+   * @param key_range Number of keys
+   * @param skew Exponent of the Zipfian distribution, in [0, 1)
+   * @param hot_keys_percent Size of the hot set, in percent of the range
+   * @param hot_ops_percent Share of the operations on the hot set, in percent
+   */
+  KeySpace(KeyDistribution distribution, long key_range, double skew = 0.99,
+           int hot_keys_percent = 10, int hot_ops_percent = 90)
+      : distribution(distribution), key_range(key_range), skew(skew),
+        hot_keys(key_range * hot_keys_percent / 100),
+        hot_ops_percent(hot_ops_percent) {
+    if (hot_keys < 1) {
+      hot_keys = 1;
+    }
+    if (distribution == KEYS_ZIPFIAN) {
+      prepare_zipfian();
+    }
+  }
+
+private:
+  /* constants of Gray et al.'s Zipfian generator, as used by YCSB */
+  double zeta_n = 0;
+  double alpha = 0;
+  double eta = 0;
+  double half_pow_skew = 0;
+
+  void prepare_zipfian() {
+    // O(key range), done once per run
+    for (long i = 1; i <= key_range; ++i) {
+      zeta_n += 1.0 / pow(static_cast<double>(i), skew);
+    }
+    double zeta_2 = 1.0 + 1.0 / pow(2.0, skew);
+    alpha = 1.0 / (1.0 - skew);
+    eta = key_range <= 2 ? 1.0
+                         : (1.0 - pow(2.0 / key_range, 1.0 - skew)) /
+                               (1.0 - zeta_2 / zeta_n);
+    half_pow_skew = pow(0.5, skew);
+  }
+
+public:
+  /**
+   * @brief Rank of a Zipfian key, 0 is the most popular
+   *
+   * @param u Uniform double in [0, 1)
+   */
+  long zipfian_rank(double u) const {
+    double uz = u * zeta_n;
+    if (uz < 1.0) {
+      return 0;
+    }
+    if (uz < 1.0 + half_pow_skew) {
+      return 1;
+    }
+    long rank = static_cast<long>(key_range * pow(eta * u - eta + 1, alpha));
+    return rank < key_range ? rank : key_range - 1;
+  }
+
+  /**
+   * @brief Map a Zipfian rank to a key. Without this, the popular keys would
+   * all be at the front of the list, where they're the cheapest to reach.
+   * Multiplying by a prime larger than the range is a bijection of the range
+   */
+  long scatter(long rank) const {
+    return static_cast<long>(static_cast<uint64_t>(rank) * 2654435761ULL %
+                             static_cast<uint64_t>(key_range));
+  }
+};
+
+/**
+ * @brief Per-thread source of keys following a KeySpace
+ */
+class KeyGenerator {
+private:
+  static constexpr int RECENT_WRITES = 16;
+
+  const KeySpace &space;
+  FastRandom rng;
+  /* first key of the hot set, moved by whoever runs the workload, or null if
+   * the hot set starts at 0 and stays there */
+  const atomic<long> *hot_start;
+  /* latest keys written by this thread, for KEYS_READ_YOUR_WRITES */
+  long recent[RECENT_WRITES] = {};
+  int recent_count = 0;
+  int recent_next = 0;
+
+  long uniform() {
+    return static_cast<long>(rng.next() %
+                             static_cast<uint64_t>(space.key_range));
+  }
+
+  long hotspot() {
+    long start = hot_start ? hot_start->load(memory_order_relaxed) : 0;
+    long cold_keys = space.key_range - space.hot_keys;
+    long offset;
+    if (cold_keys == 0 ||
+        rng.next() % 100 < static_cast<uint64_t>(space.hot_ops_percent)) {
+      offset = static_cast<long>(rng.next() %
+                                 static_cast<uint64_t>(space.hot_keys));
+    } else {
+      offset = space.hot_keys +
+               static_cast<long>(rng.next() % static_cast<uint64_t>(cold_keys));
+    }
+    return (start + offset) % space.key_range;
+  }
+
+public:
+  /**
+   * @param space Distribution of the keys
+   * @param seed Random seed, different for every thread
+   * @param hot_start First key of the hot set, null for a fixed hot set
+   */
+  KeyGenerator(const KeySpace &space, uint64_t seed,
+               const atomic<long> *hot_start = nullptr)
+      : space(space), rng(seed), hot_start(hot_start) {}
+
+  /**
+   * @brief Draw the key of the next operation
+   *
+   * @param write Whether the operation is an insert or a remove
+   * @return long Key in [0, key range)
+   */
+  long next(bool write) {
+    switch (space.distribution) {
+    case KEYS_ZIPFIAN:
+      return space.scatter(space.zipfian_rank(rng.next_unit()));
+    case KEYS_HOTSPOT:
+      return hotspot();
+    case KEYS_READ_YOUR_WRITES: {
+      if (!write && recent_count > 0) {
+        return recent[rng.next() % recent_count];
+      }
+      long key = uniform();
+      if (write) {
+        recent[recent_next] = key;
+        recent_next = (recent_next + 1) % RECENT_WRITES;
+        if (recent_count < RECENT_WRITES) {
+          recent_count++;
+        }
+      }
+      return key;
+    }
+    default:
+      return uniform();
+    }
+  }
+
+  /**
+   * @brief Random number for choosing the operation, from the same generator
+   */
+  uint64_t next_random() { return rng.next(); }
+};
+
+#endif // KEY_DISTRIBUTION_H
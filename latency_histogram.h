@@ -0,0 +1,109 @@
+/**
+ * @file latency_histogram.h
+ * @author Sihan Zhuang (sihanzhu)
+ * @brief This file contains a log-bucketed latency histogram in the style of
+ * HdrHistogram, used by the benchmark to report tail latencies.
+ * @note Values below 2^SUB_BUCKET_BITS are counted exactly. Above that, every
+ * power of two is split into 2^SUB_BUCKET_BITS equal buckets, so a recorded
+ * value is off by at most 1/32 (about 3%) whatever its magnitude. A histogram
+ * isn't thread-safe: each thread records into its own and they are merged at
+ * the end.
+ */
+
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+using namespace std;
+
+class LatencyHistogram {
+private:
+  static constexpr int SUB_BUCKET_BITS = 5;
+  static constexpr uint64_t SUB_BUCKETS = 1ULL << SUB_BUCKET_BITS;
+  /* one group of sub-buckets for the exact values, then one per power of two
+   * from 2^SUB_BUCKET_BITS up to 2^63 */
+  static constexpr size_t NUM_BUCKETS =
+      (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+  vector<uint64_t> counts;
+  uint64_t total = 0;
+  uint64_t max_value = 0;
+
+  static size_t bucket_index(uint64_t value) {
+    if (value < SUB_BUCKETS) {
+      return value;
+    }
+    int exponent = 63 - __builtin_clzll(value);
+    int shift = exponent - SUB_BUCKET_BITS;
+    uint64_t sub_bucket = (value >> shift) & (SUB_BUCKETS - 1);
+    return (shift + 1) * SUB_BUCKETS + sub_bucket;
+  }
+
+  /**
+   * @brief Get the largest value that falls into a bucket
+   */
+  static uint64_t bucket_high(size_t index) {
+    if (index < SUB_BUCKETS) {
+      return index;
+    }
+    int shift = static_cast<int>(index / SUB_BUCKETS) - 1;
+    uint64_t low = (SUB_BUCKETS + index % SUB_BUCKETS) << shift;
+    return low + ((1ULL << shift) - 1);
+  }
+
+public:
+  LatencyHistogram() : counts(NUM_BUCKETS, 0) {}
+
+  /**
+   * @brief Record one value
+   *
+   * @param value Value to be recorded, e.g. a latency in nanoseconds
+   */
+  void record(uint64_t value) {
+    counts[bucket_index(value)]++;
+    total++;
+    max_value = max(max_value, value);
+  }
+
+  /**
+   * @brief Add the values recorded by another histogram to this one
+   */
+  void merge(const LatencyHistogram &other) {
+    for (size_t i = 0; i < NUM_BUCKETS; ++i) {
+      counts[i] += other.counts[i];
+    }
+    total += other.total;
+    max_value = max(max_value, other.max_value);
+  }
+
+  uint64_t count() const { return total; }
+  uint64_t max_recorded() const { return max_value; }
+
+  /**
+   * @brief Get the value below which a given percentage of the recorded
+   * values fall
+   *
+   * @param percent Percentile, between 0 and 100
+   * @return uint64_t Upper bound of the bucket holding the percentile, never
+   * more than the largest recorded value. 0 if nothing was recorded
+   */
+  uint64_t percentile(double percent) const {
+    if (total == 0) {
+      return 0;
+    }
+    uint64_t rank = static_cast<uint64_t>(percent / 100.0 * total + 0.5);
+    rank = max<uint64_t>(1, min(rank, total));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < NUM_BUCKETS; ++i) {
+      seen += counts[i];
+      if (seen >= rank) {
+        return min(bucket_high(i), max_value);
+      }
+    }
+    return max_value;
+  }
+};
+
+#endif // LATENCY_HISTOGRAM_H
@@ -0,0 +1,233 @@
+/**
+ * @file lazy_list.h
+ * @author Sihan Zhuang (sihanzhu)
+ * @brief This file contains the implementation of a lazy linked list with
+ * fine-grained locking, as a baseline between the coarse-grain list and the
+ * lock-free lists.
+ * @note The implementation follows A Lazy Concurrent List-Based Set Algorithm
+ * by Heller et al. Traversals take no locks, insert and remove lock only the
+ * two nodes they change and validate them before changing anything. Removed
+ * nodes are freed through EpochReclaimer because an unlocked traversal might
+ * still be reading them.
+ */
+
+#ifndef LAZY_LIST_H
+#define LAZY_LIST_H
+
+#include "epoch_reclaimer.h"
+#include "node_pool.h"
+#include "sharded_counter.h"
+#include <atomic>
+#include <iostream>
+#include <mutex>
+using namespace std;
+
+template <typename T> struct LazyNode {
+  T key;
+  atomic<LazyNode *> next;
+  /* logical-delete flag, set while holding the node's lock before the node is
+   * unlinked. A node is in the set if and only if it's reachable and not
+   * marked */
+  atomic<bool> marked;
+  mutex lock;
+
+  LazyNode(const T &key) : key(key), next(nullptr), marked(false) {}
+};
+
+/**
+ * @brief A sorted linked list with per-node locks
+ *
+ * @tparam T Type of the keys
+ * @tparam Alloc Node allocator, either HeapAllocator or NodePool
+ */
+template <typename T, template <typename> class Alloc = HeapAllocator>
+class LazyList {
+private:
+  typedef Alloc<LazyNode<T>> Allocator;
+  typedef EpochReclaimer<LazyNode<T>, Allocator> Reclaimer;
+
+  // sentinel nodes
+  LazyNode<T> *head;
+  LazyNode<T> *tail;
+  static Reclaimer reclaimer;
+  ShardedCounter key_count;
+
+  /**
+   * @brief Walk the list without locking to the first node not before the
+   * key
+   *
+   * @param key Key to be searched
+   * @param pred Pointer to be modified to point to the node before curr
+   * @return LazyNode<T>* The first node whose key is not less than key
+   */
+  LazyNode<T> *locate(const T key, LazyNode<T> **pred) {
+    LazyNode<T> *prev = head;
+    LazyNode<T> *curr = prev->next.load();
+    while (curr != tail && curr->key < key) {
+      prev = curr;
+      curr = curr->next.load();
+    }
+    *pred = prev;
+    return curr;
+  }
+
+  /**
+   * @brief Check that pred and curr are still adjacent and in the list. Both
+   * nodes must be locked
+   */
+  bool validate(LazyNode<T> *pred, LazyNode<T> *curr) {
+    return !pred->marked.load() && !curr->marked.load() &&
+           pred->next.load() == curr;
+  }
+
+public:
+  LazyList() {
+    // use default constructor for T
+    head = Allocator::new_node(T{});
+    tail = Allocator::new_node(T{});
+    head->next.store(tail);
+  }
+
+  /**
+   * @brief Destroy the Lazy List object. Removed nodes are already retired, so
+   * only the reachable ones are freed here
+   */
+  ~LazyList() {
+    LazyNode<T> *curr = head;
+    while (curr != nullptr) {
+      LazyNode<T> *next = curr->next.load();
+      Allocator::delete_node(curr);
+      curr = next;
+    }
+  }
+
+  LazyNode<T> *get_head() { return head; }
+  LazyNode<T> *get_tail() { return tail; }
+  LazyNode<T> *get_front() { return head->next.load(); }
+  LazyNode<T> *get_next(LazyNode<T> *current) { return current->next.load(); }
+
+  bool insert(const T key);
+  bool remove(const T key);
+  bool find(const T search_key) { return contains(search_key); }
+  bool contains(const T search_key);
+  void print_list();
+
+  /**
+   * @brief Number of keys in the list, exact when no operation is in progress
+   */
+  size_t size() const {
+    long count = key_count.read();
+    return count > 0 ? static_cast<size_t>(count) : 0;
+  }
+
+  /**
+   * @brief Estimate of the number of keys, see ShardedCounter::approximate()
+   */
+  size_t approximate_size() const {
+    long count = key_count.approximate();
+    return count > 0 ? static_cast<size_t>(count) : 0;
+  }
+};
+
+/**
+ * @brief Insert a key into the list sorted by key
+ *
+ * @param key Key to be inserted
+ * @return true If the key is successfully inserted, false otherwise
+ */
+template <typename T, template <typename> class Alloc>
+bool LazyList<T, Alloc>::insert(const T key) {
+  typename Reclaimer::Guard guard(reclaimer);
+  while (true) {
+    LazyNode<T> *pred;
+    LazyNode<T> *curr = locate(key, &pred);
+
+    lock_guard<mutex> pred_lock(pred->lock);
+    lock_guard<mutex> curr_lock(curr->lock);
+    // the list changed between the traversal and the locking, start over
+    if (!validate(pred, curr)) {
+      continue;
+    }
+
+    if (curr != tail && curr->key == key) {
+      return false;
+    }
+
+    // only allocate once we know the insert succeeds
+    LazyNode<T> *new_node = Allocator::new_node(key);
+    new_node->next.store(curr);
+    pred->next.store(new_node);
+    key_count.add(1);
+    return true;
+  }
+}
+
+/**
+ * @brief Remove a key from the list. The node is marked first, which is when
+ * it leaves the set, and then unlinked
+ *
+ * @param key Key to be removed
+ * @return true If the key is successfully removed, false if the key is not
+ * found
+ */
+template <typename T, template <typename> class Alloc>
+bool LazyList<T, Alloc>::remove(const T key) {
+  typename Reclaimer::Guard guard(reclaimer);
+  while (true) {
+    LazyNode<T> *pred;
+    LazyNode<T> *curr = locate(key, &pred);
+
+    {
+      lock_guard<mutex> pred_lock(pred->lock);
+      lock_guard<mutex> curr_lock(curr->lock);
+      if (!validate(pred, curr)) {
+        continue;
+      }
+
+      if (curr == tail || curr->key != key) {
+        return false;
+      }
+
+      curr->marked.store(true);
+      pred->next.store(curr->next.load());
+    }
+    key_count.add(-1);
+    // the node is unreachable now, but unlocked traversals might still be on
+    // it
+    reclaimer.retire_node(curr);
+    return true;
+  }
+}
+
+/**
+ * @brief Find a key in the list. Takes no locks and never retries
+ *
+ * @param search_key Key to be searched
+ * @return true If the key is found, false otherwise
+ */
+template <typename T, template <typename> class Alloc>
+bool LazyList<T, Alloc>::contains(const T search_key) {
+  typename Reclaimer::Guard guard(reclaimer);
+  LazyNode<T> *pred;
+  LazyNode<T> *curr = locate(search_key, &pred);
+  return curr != tail && curr->key == search_key && !curr->marked.load();
+}
+
+/**
+ * @brief A helper function to print the list after operations
+ * @note Not thread-safe
+ */
+template <typename T, template <typename> class Alloc>
+void LazyList<T, Alloc>::print_list() {
+  LazyNode<T> *current = get_front();
+  while (current != tail) {
+    cout << current->key << " -> ";
+    current = current->next.load();
+  }
+  cout << "NULL\n";
+}
+
+template <typename T, template <typename> class Alloc>
+typename LazyList<T, Alloc>::Reclaimer LazyList<T, Alloc>::reclaimer;
+
+#endif // LAZY_LIST_H
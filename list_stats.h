@@ -0,0 +1,131 @@
+/**
+ * @file list_stats.h
+ * @author Sihan Zhuang (sihanzhu)
+ * @brief This file contains the contention counters of the lock-free lists.
+ * They show where the time goes under contention: how often searches restart,
+ * how many CAS fail, how far operations walk and how much memory is waiting
+ * to be reclaimed.
+ * @note The counters are compiled out unless LIST_STATS is defined (e.g. with
+ * make bench BENCH_FLAGS=-DLIST_STATS). Without it, StatCounters is empty and
+ * every add() is an empty inline call, so the lists pay nothing for them.
+ */
+
+#ifndef LIST_STATS_H
+#define LIST_STATS_H
+
+#include "sharded_counter.h"
+#include <array>
+#include <atomic>
+using namespace std;
+
+// #define LIST_STATS
+
+enum StatEvent {
+  STAT_OPERATIONS,
+  /* search() started over from the beginning */
+  STAT_SEARCH_RESTARTS,
+  /* CAS that failed while linking, marking or unlinking a node */
+  STAT_CAS_FAILURES,
+  /* nodes stepped past on the way to the key */
+  STAT_NODES_TRAVERSED,
+  /* marked nodes met on the way, whether they were unlinked or stepped over */
+  STAT_MARKED_SKIPPED,
+  /* marked nodes unlinked by search(), on behalf of the thread removing them
+   * or not */
+  STAT_HELPING_UNLINKS,
+  STAT_NODES_RETIRED,
+  STAT_NODES_FREED,
+  NUM_STAT_EVENTS
+};
+
+/**
+ * @brief Snapshot of the counters of a list
+ */
+struct ListStats {
+  long operations = 0;
+  long search_restarts = 0;
+  long cas_failures = 0;
+  long nodes_traversed = 0;
+  long marked_skipped = 0;
+  long helping_unlinks = 0;
+  long nodes_retired = 0;
+  long nodes_freed = 0;
+  /* nodes retired but not freed yet, summed over the retired lists of every
+   * thread */
+  long retired_pending = 0;
+};
+
+#ifdef LIST_STATS
+
+/**
+ * @brief Per-thread event counters, each thread counting into its own cache
+ * line like ShardedCounter
+ */
+class StatCounters {
+private:
+  struct alignas(CACHE_LINE_SIZE) Shard {
+    array<atomic<long>, NUM_STAT_EVENTS> events;
+
+    Shard() {
+      for (auto &event : events)
+        event.store(0);
+    }
+  };
+
+  array<Shard, COUNTER_SHARDS> shards;
+
+public:
+  static constexpr bool enabled = true;
+
+  void add(StatEvent event, long n = 1) {
+    shards[thread_slot()].events[event].fetch_add(n, memory_order_relaxed);
+  }
+
+  /**
+   * @brief Sum the shards of one event
+   * @note Only exact if no thread is counting at the same time
+   */
+  long read(StatEvent event) const {
+    long total = 0;
+    for (const auto &shard : shards)
+      total += shard.events[event].load(memory_order_relaxed);
+    return total;
+  }
+};
+
+#else
+
+class StatCounters {
+public:
+  static constexpr bool enabled = false;
+
+  void add(StatEvent, long = 1) {}
+  long read(StatEvent) const { return 0; }
+};
+
+#endif // LIST_STATS
+
+/**
+ * @brief Build a snapshot from the counters of a list and of its reclaimer
+ *
+ * @param list Counters of the list
+ * @param reclaim Counters of the reclaimer, only STAT_NODES_RETIRED and
+ * STAT_NODES_FREED are read from it
+ * @return ListStats The snapshot
+ */
+inline ListStats make_list_stats(const StatCounters &list,
+                                 const StatCounters &reclaim) {
+  ListStats stats;
+  stats.operations = list.read(STAT_OPERATIONS);
+  stats.search_restarts = list.read(STAT_SEARCH_RESTARTS);
+  stats.cas_failures = list.read(STAT_CAS_FAILURES);
+  stats.nodes_traversed = list.read(STAT_NODES_TRAVERSED);
+  stats.marked_skipped = list.read(STAT_MARKED_SKIPPED);
+  stats.helping_unlinks = list.read(STAT_HELPING_UNLINKS);
+  stats.nodes_retired = reclaim.read(STAT_NODES_RETIRED);
+  stats.nodes_freed = reclaim.read(STAT_NODES_FREED);
+  stats.retired_pending = stats.nodes_retired - stats.nodes_freed;
+  return stats;
+}
+
+#endif // LIST_STATS_H
@@ -15,9 +15,20 @@
 #ifndef LOCK_FREE_LIST_H
 #define LOCK_FREE_LIST_H
 
+#include "backoff.h"
+#include "bulk_load.h"
+#include "epoch_reclaimer.h"
+#include "finger.h"
+#include "hazard_pointer.h"
+#include "list_stats.h"
+#include "marked_pointer.h"
+#include "memory_ordering.h"
+#include "sentinel_keys.h"
+#include "sharded_counter.h"
 #include <assert.h>
 #include <atomic>
 #include <iostream>
+#include <stdexcept>
 #include <thread>
 #include <vector>
 using namespace std;
@@ -30,158 +41,102 @@ using namespace std;
 #define ASSERT(x)
 #endif
 
-/**
- * @brief A class to manage hazard pointers for lock-free data structures
- *
- * We use an array of hazard pointers for each thread. Each thread can have
- * up to HP_PER_THREAD hazard pointers. Pointers stored in the array are
- * protected from being deleted. When a thread no longer need the reference to a
- * node, we can safely replace the pointer (stored in a specific index) with the
- * next one. The hazard pointers are used to protect nodes from being deleted
- * while they are still being accessed by other threads.
- *
- * @tparam T Type of the data structure
- */
-template <typename T> class HazardPointer {
-private:
-  static constexpr int MAX_THREADS = 256;
-  static constexpr int HP_PER_THREAD = 5;
-
-  struct HPRec {
-    atomic<thread::id> thread_id;
-    array<atomic<T *>, HP_PER_THREAD> hp;
-
-    HPRec() : thread_id(thread::id()) {
-      for (auto &h : hp)
-        h.store(nullptr);
-    }
-  };
-
-  array<HPRec, MAX_THREADS> hp_list;
-
-  /**
-   * @brief Function to claim a hazard pointer record (spot in the array)
-   *
-   * @return HPRec* Pointer to the hazard pointer record
-   */
-  HPRec *acquire_hp_rec() {
-    auto tid = this_thread::get_id();
-    for (auto &rec : hp_list) {
-      thread::id empty;
-      if (rec.thread_id.compare_exchange_strong(empty, tid)) {
-        return &rec;
-      }
-      if (rec.thread_id.load() == tid) {
-        return &rec;
-      }
-    }
-    throw runtime_error("No available hazard pointer records");
-  }
-
-public:
-  /* below are helper functions to get/set states in the array */
-  T *get_protected(int hp_index) {
-    auto rec = acquire_hp_rec();
-    return rec->hp[hp_index].load();
-  }
-
-  void protect(T *ptr, int hp_index) {
-    auto rec = acquire_hp_rec();
-    rec->hp[hp_index].store(ptr);
-  }
-
-  void clear(int hp_index) {
-    auto rec = acquire_hp_rec();
-    rec->hp[hp_index].store(nullptr);
-  }
-
-  bool is_protected(T *ptr) {
-    for (const auto &rec : hp_list) {
-      // record is not empty
-      if (rec.thread_id.load() != thread::id()) {
-        for (const auto &hp : rec.hp) {
-          // found a match, the ptr is protected
-          if (hp.load() == ptr)
-            return true;
-        }
-      }
-    }
-    return false;
-  }
-
-  /**
-   * @brief Retire a node and free the memory if possible
-   *
-   * @param ptr Pointer to the node to be retired
-   */
-  void retire_node(T *ptr) {
-    const int DELETION_THRESHOLD = 50;
-
-    static thread_local vector<T *> retired_list;
-    static thread_local int retired_count = 0;
-
-    retired_list.push_back(ptr);
-    retired_count++;
-
-    // Scan and free nodes that are safe to delete
-    if (retired_count >= DELETION_THRESHOLD) {
-      vector<T *> new_retired_list;
-      for (auto node : retired_list) {
-        if (!is_protected(node)) {
-          // mark the memory before deleting
-          node->deleted.store(true);
-          delete node;
-          retired_count--;
-        } else {
-          new_retired_list.push_back(node);
-        }
-      }
-      retired_list = move(new_retired_list);
-    }
-  }
-};
-
 template <typename KeyType> struct LockFreeNode {
   KeyType key;
+  /* the lowest bit of next is used to indicate that the node is logically
+   * deleted (see marked_pointer.h), this makes sure that other threads don't
+   * try to link new nodes after it before we have a chance to physically
+   * delete it. The mark and the link are always changed by the same CAS */
   atomic<LockFreeNode *> next;
-  /* marked is used to indicate that the node is logically deleted, this
-   * makes sure that other threads don't try to access the node before we have a
-   * chance to physically delete them */
-  /* TODO: extra memory usage, could use the last bit of next pointer instead
-    because the LockFreeNode structure is more than 1 byte aligned */
-  atomic<bool> marked;
-  atomic<bool> deleted;
-  LockFreeNode(KeyType key)
-      : key(key), next(nullptr), marked(false), deleted(false) {}
+  LockFreeNode(KeyType key) : key(key), next(nullptr) {}
 
   /**
    * @brief Helper function to check if the node is marked for deletion
-   * @note The load() function is used to make sure that the value is read
-   * with memory fence
+   * @param order Memory ordering of the load
    * @return Whether the node is marked for deletion
    */
-  bool is_marked() { return marked.load(); }
-
-  bool is_deleted() { return deleted.load(); }
+  bool is_marked(memory_order order = memory_order_seq_cst) {
+    return is_marked_reference(next.load(order));
+  }
 };
 
-template <typename KeyType> class LockFreeList {
+/**
+ * @brief A lock-free sorted linked list
+ *
+ * @tparam KeyType Type of the keys
+ * @tparam Reclaim Memory reclamation policy, either HazardPointer (a hazard
+ * pointer is published for every node visited), PaddedHazardPointer (same,
+ * with one cache line per thread) or EpochReclaimer (one critical section per
+ * operation)
+ * @tparam Alloc Node allocator, either HeapAllocator or NodePool
+ * @tparam Ordering Memory ordering of the accesses to the next pointers,
+ * either SeqCstOrdering or AcquireReleaseOrdering (see memory_ordering.h)
+ * @tparam Backoff What to do after a failed CAS before retrying, either
+ * NoBackoff, ExponentialBackoff or RandomizedBackoff (see backoff.h)
+ */
+template <typename KeyType,
+          template <typename, typename> class Reclaim = HazardPointer,
+          template <typename> class Alloc = HeapAllocator,
+          typename Ordering = SeqCstOrdering, typename Backoff = NoBackoff>
+class LockFreeList {
 private:
+  typedef Alloc<LockFreeNode<KeyType>> Allocator;
+  typedef Reclaim<LockFreeNode<KeyType>, Allocator> Reclaimer;
+
   LockFreeNode<KeyType> *head;
   LockFreeNode<KeyType> *tail;
-  static HazardPointer<LockFreeNode<KeyType>> hp_manager;
+  static Reclaimer reclaimer;
+  /* contention counters, empty unless LIST_STATS is defined */
+  StatCounters stat_counters;
+  /* keys in the list, sentinels inserted by insert_sentinel excluded */
+  ShardedCounter key_count;
+  /* identifies the list in the fingers of the threads, see finger.h */
+  const uint64_t list_id = next_list_id();
+  bool finger_enabled = false;
+
+  static Finger<LockFreeNode<KeyType>> &local_finger() {
+    static thread_local Finger<LockFreeNode<KeyType>> finger;
+    return finger;
+  }
+  LockFreeNode<KeyType> *finger_start(const KeyType &key);
+  void save_finger(LockFreeNode<KeyType> *node);
+
+  template <typename Stop>
+  LockFreeNode<KeyType> *search_until(LockFreeNode<KeyType> *start, Stop stop,
+                                      LockFreeNode<KeyType> **left_node);
+  LockFreeNode<KeyType> *search(LockFreeNode<KeyType> *start,
+                                const KeyType key,
+                                LockFreeNode<KeyType> **left_node) {
+    auto past_key = [&key](LockFreeNode<KeyType> *node) {
+      return !(node->key < key);
+    };
+    return search_until(start, past_key, left_node);
+  }
+  bool pop_near_front(KeyType &key, unsigned spray_width);
 
-  LockFreeNode<KeyType> *search(const KeyType key,
-                                LockFreeNode<KeyType> **left_node);
+  /**
+   * @brief Node the next key of a batch is searched from: where the previous
+   * key's search stopped, or the head if the batch isn't sorted there
+   * @note start must be protected
+   */
+  LockFreeNode<KeyType> *batch_start(LockFreeNode<KeyType> *start,
+                                     const KeyType &key) const {
+    return start == head || start->key < key ? start : head;
+  }
+  bool insert_at(LockFreeNode<KeyType> *start, const KeyType key,
+                 LockFreeNode<KeyType> **left_node);
+  bool remove_at(LockFreeNode<KeyType> *start, const KeyType key,
+                 LockFreeNode<KeyType> **left_node);
+  bool find_at(LockFreeNode<KeyType> *start, const KeyType search_key,
+               LockFreeNode<KeyType> **left_node);
 
 public:
   /**
    * @brief Construct a new Lock Free List object
    */
   LockFreeList() {
-    // use default constructor for KeyType
-    head = new LockFreeNode<KeyType>(KeyType{});
-    tail = new LockFreeNode<KeyType>(KeyType{});
+    head = Allocator::new_node(SentinelKeys<KeyType>::head_key());
+    tail = Allocator::new_node(SentinelKeys<KeyType>::tail_key());
     head->next.store(tail);
   }
 
@@ -191,16 +146,16 @@ public:
   ~LockFreeList() {
     LockFreeNode<KeyType> *curr = head;
     while (curr != nullptr) {
-      LockFreeNode<KeyType> *next = curr->next.load();
-      hp_manager.retire_node(curr);
+      LockFreeNode<KeyType> *next = get_unmarked_reference(curr->next.load());
+      reclaimer.retire_node(curr);
       curr = next;
     }
   }
 
-  bool get_marked(LockFreeNode<KeyType> *node) { return node->marked.load(); }
+  bool get_marked(LockFreeNode<KeyType> *node) { return node->is_marked(); }
   KeyType get_key(LockFreeNode<KeyType> *node) { return node->key; }
   LockFreeNode<KeyType> *get_next(LockFreeNode<KeyType> *node) {
-    return node->next.load();
+    return get_unmarked_reference(node->next.load());
   }
 
   /**
@@ -230,7 +185,77 @@ public:
   bool insert(const KeyType key);
   bool remove(const KeyType key);
   bool find(const KeyType search_key);
+  bool contains(const KeyType search_key) { return find(search_key); }
+
+  /* priority queue operations, the smallest key has the highest priority */
+  bool peek_min(KeyType &key);
+  bool pop_min(KeyType &key) { return pop_near_front(key, 1); }
+  bool pop_min_relaxed(KeyType &key, unsigned spray_width) {
+    return pop_near_front(key, spray_width);
+  }
+
+  /**
+   * @brief Let insert(), remove() and find() start from the node the calling
+   * thread's previous operation stopped before, when it's before the key,
+   * instead of from the head (see finger.h). Off by default
+   * @note Must be set before the list is shared between threads
+   */
+  void enable_finger(bool enabled) { finger_enabled = enabled; }
+
+  /* same as above, but the search starts at a node that is known to be
+   * before the key and is never removed, instead of at the head. This lets
+   * a structure built on top of the list (e.g. SplitOrderedSet) keep its own
+   * entry points into the list */
+  bool insert_from(LockFreeNode<KeyType> *start, const KeyType key);
+  bool remove_from(LockFreeNode<KeyType> *start, const KeyType key);
+  bool find_from(LockFreeNode<KeyType> *start, const KeyType search_key);
+  LockFreeNode<KeyType> *insert_sentinel(LockFreeNode<KeyType> *start,
+                                         const KeyType key);
+
+  template <typename Iterator>
+  size_t insert_batch(Iterator first, Iterator last);
+  template <typename Iterator>
+  size_t remove_batch(Iterator first, Iterator last);
+  template <typename Iterator>
+  size_t bulk_load(Iterator first, Iterator last, unsigned num_threads = 0);
+
+  template <typename Visitor>
+  void for_each_in_range(const KeyType lo, const KeyType hi, Visitor visit);
+  size_t range_query(const KeyType lo, const KeyType hi,
+                     vector<KeyType> &out);
   void print_list();
+
+  /**
+   * @brief Number of keys in the list, summed over the per-thread counters
+   * @note Exact when no operation is in progress, otherwise each thread's
+   * count may be off by the operations it is in the middle of
+   * @return size_t The number of keys
+   */
+  size_t size() const {
+    long count = key_count.read();
+    return count > 0 ? static_cast<size_t>(count) : 0;
+  }
+
+  /**
+   * @brief Cheap estimate of the number of keys, a single load
+   * @return size_t The number of keys, off by less than
+   * ShardedCounter::APPROXIMATE_STEP for every thread that updated the list
+   */
+  size_t approximate_size() const {
+    long count = key_count.approximate();
+    return count > 0 ? static_cast<size_t>(count) : 0;
+  }
+
+  /**
+   * @brief Snapshot of the contention counters, all zero unless LIST_STATS is
+   * defined
+   * @note The retired and freed counts come from the reclaimer, which is
+   * shared by every list of the same type
+   * @return ListStats The counters
+   */
+  ListStats stats() const {
+    return make_list_stats(stat_counters, reclaimer.get_stats());
+  }
   bool addr_valid(LockFreeNode<KeyType> *node) {
     uintptr_t addr = reinterpret_cast<uintptr_t>(node);
     uintptr_t addr_high = addr >> 44;
@@ -239,217 +264,812 @@ public:
 };
 
 /**
- * @brief Search for a spot to insert the key
+ * @brief Search for the first unmarked node the stop condition holds for, and
+ * the node before it. search(start, key, left_node) stops at the first node
+ * whose key isn't less than the key, which is the spot to insert the key at
  *
- * @param key Key to be inserted
+ * Unlike the paper, marked nodes are unlinked one at a time as they are met
+ * (the variant described by Maged Michael). A chain of marked nodes can't be
+ * skipped with a single CAS because a node reached only through a marked node
+ * might already have been retired, and the hazard pointer validation below
+ * (prev->next still equals curr) only holds for an unmarked prev.
+ *
+ * @param start Node to start from, must be before the node searched for. If
+ * it's marked, the search starts from the head instead
+ * @param stop Called as stop(node) on the unmarked nodes after start in
+ * order, until it returns true. Called with the tail too, when the keys are
+ * bounded (see sentinel_keys.h), and must return true for it
  * @param left_node Pointer to be modified to point to the node before the
- * key
+ * node searched for
  * @note compare_exchange_weak is not used because although it's documented that
  * it's faster than spinning on compare_exchange_strong, the amount of extra
  * work involved in each iteration is not minimal
- * @return LockFreeNode<KeyType>* The node to the right where the key should be
- * inserted
+ * @note Must be called inside a Reclaimer::Guard, with start protected by
+ * hazard pointer 3 unless it's never removed. On return, left_node is
+ * protected by hazard pointer 0 and the returned node by hazard pointer 1
+ * @return LockFreeNode<KeyType>* The node stop returned true for, or the tail
  */
-template <typename KeyType>
+template <typename KeyType, template <typename, typename> class Reclaim,
+          template <typename> class Alloc, typename Ordering,
+          typename Backoff>
+template <typename Stop>
 LockFreeNode<KeyType> *
-LockFreeList<KeyType>::search(const KeyType key,
-                              LockFreeNode<KeyType> **left_node) {
+LockFreeList<KeyType, Reclaim, Alloc, Ordering, Backoff>::search_until(
+    LockFreeNode<KeyType> *start, Stop stop,
+    LockFreeNode<KeyType> **left_node) {
+  LockFreeNode<KeyType> *prev, *curr, *succ;
+  Backoff backoff;
 retry:
-  // hp_manager.clear(0);
-  // hp_manager.clear(1);
-  // hp_manager.clear(2);
+  prev = start;
+  reclaimer.protect(prev, 0);
+  curr = prev->next.load(Ordering::traverse);
+  // a batch resumes from the previous key's left_node, which might have been
+  // removed since
+  if (is_marked_reference(curr)) {
+    stat_counters.add(STAT_SEARCH_RESTARTS);
+    start = head;
+    goto retry;
+  }
 
-  LockFreeNode<KeyType> *left_node_next;
-  LockFreeNode<KeyType> *right_node;
   while (true) {
-    LockFreeNode<KeyType> *t = head;
-    hp_manager.protect(t, 0);
-    LockFreeNode<KeyType> *t_next = head->next.load();
-    hp_manager.protect(t_next, 1);
-    if (t->next.load() != t_next || t->is_deleted() || t_next->is_deleted()) {
+    reclaimer.protect(curr, 1);
+    // NOTE: one of the potential races we are trying to solve here. curr could
+    // get unlinked (and retired) before we publish the hazard pointer. If prev
+    // still points to it without a mark, curr is still in the list. Epoch
+    // based reclamation doesn't need this because the whole operation is
+    // protected
+    if (Reclaimer::protects_per_node &&
+        prev->next.load(Ordering::validate) != curr) {
+      stat_counters.add(STAT_SEARCH_RESTARTS);
+      backoff.pause();
       goto retry;
     }
-
-    // 1. Find left_node and right_node (right node might be marked)
-    do {
-      ASSERT(hp_manager.is_protected(t));
-      ASSERT(hp_manager.is_protected(t_next));
-      /* unlike the paper, where the references are stored in the next
-       * pointer, we already have a dedicated field for mark checking */
-      if (!t->is_marked()) {
-        ASSERT(hp_manager.is_protected(t));
-        *left_node = t;
-        hp_manager.protect(*left_node, 3);
-        if (t->is_deleted()) {
-          goto retry;
-        }
-        left_node_next = t_next;
-      }
-
-      // NOTE: unlike the paper, we don't need get_marked_reference()
-      // because the pointer is not changed in this implementation
-      t = t_next;
-      if (t == tail) {
+    // with bounded keys, the stop condition below stops at the tail, whose
+    // next pointer is null and never marked
+    if constexpr (!SentinelKeys<KeyType>::bounded) {
+      if (curr == tail) {
         break;
       }
-      // t_next updated after the break statement because if we break here,
-      // we no longer need to update left_node_next
-      t_next = t->next.load();
-      hp_manager.protect(t_next, 2);
-      // NOTE: one of the potential races we are trying to solve here. t->next
-      // could get physically deleted after we load
-      if (t->next.load() != t_next || t->is_deleted() || t_next->is_deleted()) {
+    }
+
+    // the mark and the link are read together
+    succ = curr->next.load(Ordering::traverse);
+    if (is_marked_reference(succ)) {
+      // curr is logically deleted, help to physically remove it
+      stat_counters.add(STAT_MARKED_SKIPPED);
+      succ = get_unmarked_reference(succ);
+      LockFreeNode<KeyType> *expected = curr;
+      if (!prev->next.compare_exchange_strong(expected, succ, Ordering::publish,
+                                              Ordering::publish_failure)) {
+        stat_counters.add(STAT_CAS_FAILURES);
+        stat_counters.add(STAT_SEARCH_RESTARTS);
+        backoff.pause();
         goto retry;
       }
+      stat_counters.add(STAT_HELPING_UNLINKS);
+      // whoever unlinks the node is responsible for retiring it
+      reclaimer.retire_node(curr);
+      curr = succ;
+      continue;
+    }
 
-      // rotate the hazard pointers
-      hp_manager.protect(t, 0);
-      ASSERT(!t->is_deleted());
-      hp_manager.protect(t_next, 1);
-      ASSERT(!t_next->is_deleted());
-
-      ASSERT(hp_manager.is_protected(t));
-      ASSERT(hp_manager.is_protected(t_next));
-
-      // keep looping until we find a right node that is not marked
-    } while (t->is_marked() || t->key < key);
-
-    right_node = t;
-    ASSERT(hp_manager.is_protected(right_node));
-
-    // 2. Check if the nodes are adjacent
-    if (left_node_next == right_node) {
-      // if right node is marked, search again
-      if (right_node != tail && right_node->is_marked()) {
-        continue;
-      } else {
-        // found the right node
-        return right_node;
-      }
+    if (stop(curr)) {
+      break;
     }
 
-    // 3. Remove one or more marked nodes from left to right node
-    // this is run many times until we find the right node
-    ASSERT(hp_manager.is_protected(*left_node));
-    ASSERT(hp_manager.is_protected(right_node));
-    if ((*left_node)
-            ->next.compare_exchange_strong(left_node_next, right_node)) {
-      if (right_node != tail && right_node->is_marked()) {
-        continue;
-      } else {
-        return right_node;
+    // rotate the hazard pointers, curr stays protected by hazard pointer 1
+    // until it's published as the new prev
+    stat_counters.add(STAT_NODES_TRAVERSED);
+    prev = curr;
+    reclaimer.protect(prev, 0);
+    curr = succ;
+  }
+
+  ASSERT(reclaimer.is_protected(prev));
+  ASSERT(reclaimer.is_protected(curr));
+  *left_node = prev;
+  return curr;
+}
+
+/**
+ * @brief Pick the node an operation on the key starts from: the calling
+ * thread's finger if it's enabled, still safe to use, unmarked and before the
+ * key, the head otherwise
+ *
+ * @param key Key of the operation
+ * @note Must be called inside a Reclaimer::Guard. The returned node is
+ * protected by hazard pointer 3, as search() expects
+ * @return LockFreeNode<KeyType>* The node to start from
+ */
+template <typename KeyType, template <typename, typename> class Reclaim,
+          template <typename> class Alloc, typename Ordering,
+          typename Backoff>
+LockFreeNode<KeyType> *
+LockFreeList<KeyType, Reclaim, Alloc, Ordering, Backoff>::finger_start(
+    const KeyType &key) {
+  if (!finger_enabled) {
+    return head;
+  }
+  Finger<LockFreeNode<KeyType>> &finger = local_finger();
+  // the node is only read once we know it can't have been freed
+  if (finger.list_id != list_id ||
+      !reclaimer.finger_pinned(finger.node, finger.stamp) ||
+      !(finger.node->key < key) || finger.node->is_marked(Ordering::traverse)) {
+    return head;
+  }
+  reclaimer.protect(finger.node, 3);
+  return finger.node;
+}
+
+/**
+ * @brief Make a node the calling thread's finger, if the finger is enabled
+ *
+ * @param node Node an operation stopped before, protected by the caller
+ */
+template <typename KeyType, template <typename, typename> class Reclaim,
+          template <typename> class Alloc, typename Ordering,
+          typename Backoff>
+void LockFreeList<KeyType, Reclaim, Alloc, Ordering, Backoff>::save_finger(
+    LockFreeNode<KeyType> *node) {
+  if (!finger_enabled || node == head) {
+    return;
+  }
+  Finger<LockFreeNode<KeyType>> &finger = local_finger();
+  finger.list_id = list_id;
+  finger.node = node;
+  finger.stamp = reclaimer.pin_finger(node);
+}
+
+/**
+ * @brief Insert a key into the list sorted by key
+ *
+ * @param key Key to be inserted
+ * @return true If the key is successfully inserted, false otherwise
+ */
+template <typename KeyType, template <typename, typename> class Reclaim,
+          template <typename> class Alloc, typename Ordering,
+          typename Backoff>
+bool LockFreeList<KeyType, Reclaim, Alloc, Ordering, Backoff>::insert(
+    const KeyType key) {
+  typename Reclaimer::Guard guard(reclaimer);
+  LockFreeNode<KeyType> *left_node;
+  bool inserted = insert_at(finger_start(key), key, &left_node);
+  save_finger(left_node);
+  return inserted;
+}
+
+/**
+ * @brief Remove a key from the list
+ *
+ * @param key Key to be removed
+ * @return true If the key is successfully removed, false if the key is not
+ * found
+ */
+template <typename KeyType, template <typename, typename> class Reclaim,
+          template <typename> class Alloc, typename Ordering,
+          typename Backoff>
+bool LockFreeList<KeyType, Reclaim, Alloc, Ordering, Backoff>::remove(
+    const KeyType key) {
+  typename Reclaimer::Guard guard(reclaimer);
+  LockFreeNode<KeyType> *left_node;
+  bool removed = remove_at(finger_start(key), key, &left_node);
+  save_finger(left_node);
+  return removed;
+}
+
+/**
+ * @brief Get the smallest key of the list without removing it
+ *
+ * @param key Set to the smallest key, if the list isn't empty
+ * @return true If the list isn't empty, false otherwise
+ */
+template <typename KeyType, template <typename, typename> class Reclaim,
+          template <typename> class Alloc, typename Ordering,
+          typename Backoff>
+bool LockFreeList<KeyType, Reclaim, Alloc, Ordering, Backoff>::peek_min(
+    KeyType &key) {
+  typename Reclaimer::Guard guard(reclaimer);
+  LockFreeNode<KeyType> *left_node;
+  stat_counters.add(STAT_OPERATIONS);
+  LockFreeNode<KeyType> *front =
+      search_until(head, [](LockFreeNode<KeyType> *) { return true; },
+                   &left_node);
+  if (front == tail) {
+    return false;
+  }
+  key = front->key;
+  return true;
+}
+
+/**
+ * @brief Remove one of the smallest keys of the list
+ *
+ * With a spray width of 1, this removes the smallest key, and every thread
+ * fights over the first node. A wider spray picks a random one of the first
+ * spray_width keys instead (a much simplified SprayList), so that threads
+ * popping at the same time mark different nodes. A key may then be popped
+ * while up to spray_width - 1 smaller ones are still in the list.
+ *
+ * @param key Set to the removed key, if the list isn't empty
+ * @param spray_width Number of keys at the front to pick from, at least 1
+ * @note Reuses remove()'s mark-then-unlink, the node is retired by whoever
+ * unlinks it
+ * @return true If a key was removed, false if the list is empty
+ */
+template <typename KeyType, template <typename, typename> class Reclaim,
+          template <typename> class Alloc, typename Ordering,
+          typename Backoff>
+bool LockFreeList<KeyType, Reclaim, Alloc, Ordering, Backoff>::pop_near_front(
+    KeyType &key, unsigned spray_width) {
+  typename Reclaimer::Guard guard(reclaimer);
+  LockFreeNode<KeyType> *left_node, *right_node, *right_node_next;
+  Backoff backoff;
+  stat_counters.add(STAT_OPERATIONS);
+  unsigned skip = spray_width > 1 ? thread_random() % spray_width : 0;
+
+  while (true) {
+    // stop at the first unmarked node once skip of them were passed
+    unsigned left_to_skip = skip;
+    right_node = search_until(
+        head,
+        [this, &left_to_skip](LockFreeNode<KeyType> *node) {
+          return node == tail || left_to_skip-- == 0;
+        },
+        &left_node);
+    if (right_node == tail) {
+      if (left_node == head) {
+        return false;
       }
+      // fewer keys than the spray, take the first one
+      skip = 0;
+      continue;
+    }
+
+    // same marking as in remove_at()
+    right_node_next = right_node->next.load(Ordering::traverse);
+    if (is_marked_reference(right_node_next)) {
+      continue;
+    }
+    if (right_node->next.compare_exchange_strong(
+            right_node_next, get_marked_reference(right_node_next),
+            Ordering::publish, Ordering::publish_failure)) {
+      break;
     }
+    stat_counters.add(STAT_CAS_FAILURES);
+    backoff.pause();
+  }
+  key = right_node->key;
+  key_count.add(-1);
+  if (left_node->next.compare_exchange_strong(right_node, right_node_next,
+                                              Ordering::publish,
+                                              Ordering::publish_failure)) {
+    reclaimer.retire_node(right_node);
+  } else {
+    stat_counters.add(STAT_CAS_FAILURES);
+    search(head, key, &left_node);
   }
+  return true;
+}
+
+/**
+ * @brief Find a key in the list
+ *
+ * @param search_key Key to be searched
+ * @return true If the key is found, false otherwise
+ */
+template <typename KeyType, template <typename, typename> class Reclaim,
+          template <typename> class Alloc, typename Ordering,
+          typename Backoff>
+bool LockFreeList<KeyType, Reclaim, Alloc, Ordering, Backoff>::find(
+    const KeyType search_key) {
+  typename Reclaimer::Guard guard(reclaimer);
+  LockFreeNode<KeyType> *left_node;
+  bool found = find_at(finger_start(search_key), search_key, &left_node);
+  save_finger(left_node);
+  return found;
 }
 
 /**
  * @brief Insert a key into the list sorted by key
  *
+ * @param start Node to start the search from
  * @param key Key to be inserted
  * @return true If the key is successfully inserted, false otherwise
  */
-template <typename KeyType>
-bool LockFreeList<KeyType>::insert(const KeyType key) {
-  LockFreeNode<KeyType> *new_node = new LockFreeNode<KeyType>(key);
-  LockFreeNode<KeyType> *left_node, *right_node;
+template <typename KeyType, template <typename, typename> class Reclaim,
+          template <typename> class Alloc, typename Ordering,
+          typename Backoff>
+bool LockFreeList<KeyType, Reclaim, Alloc, Ordering, Backoff>::insert_from(
+    LockFreeNode<KeyType> *start, const KeyType key) {
+  typename Reclaimer::Guard guard(reclaimer);
+  LockFreeNode<KeyType> *left_node;
+  return insert_at(start, key, &left_node);
+}
+
+/**
+ * @brief Insert a key, the caller is responsible for the Reclaimer::Guard
+ *
+ * @param start Node to start the search from
+ * @param key Key to be inserted
+ * @param left_node Set to the node before the key, protected by hazard pointer
+ * 0 on return
+ * @return true If the key is successfully inserted, false otherwise
+ */
+template <typename KeyType, template <typename, typename> class Reclaim,
+          template <typename> class Alloc, typename Ordering,
+          typename Backoff>
+bool LockFreeList<KeyType, Reclaim, Alloc, Ordering, Backoff>::insert_at(
+    LockFreeNode<KeyType> *start, const KeyType key,
+    LockFreeNode<KeyType> **left_node) {
+  // the node is only allocated once we know the key isn't in the list, and
+  // it's reused if the CAS fails
+  LockFreeNode<KeyType> *new_node = nullptr;
+  LockFreeNode<KeyType> *right_node;
+  Backoff backoff;
+  stat_counters.add(STAT_OPERATIONS);
 
   while (true) {
-    right_node = search(key, &left_node);
-    ASSERT(hp_manager.is_protected(right_node));
+    right_node = search(start, key, left_node);
+    ASSERT(reclaimer.is_protected(right_node));
 
-    // duplicate key, release allocated memory
+    // duplicate key, release allocated memory. The node was never published,
+    // so it can be freed right away
     if (right_node != tail && right_node->key == key) {
+      if (new_node != nullptr) {
+        Allocator::delete_node(new_node);
+      }
       return false;
     }
 
-    new_node->next.store(right_node);
+    if (new_node == nullptr) {
+      new_node = Allocator::new_node(key);
+    }
+    new_node->next.store(right_node, Ordering::init);
 
-    ASSERT(hp_manager.is_protected(left_node));
-    ASSERT(hp_manager.is_protected(right_node));
+    ASSERT(reclaimer.is_protected(*left_node));
+    ASSERT(reclaimer.is_protected(right_node));
 
-    // loop back until we get a chance to insert the new node
-    if (left_node->next.compare_exchange_strong(right_node, new_node)) {
+    // loop back until we get a chance to insert the new node. The CAS fails if
+    // left_node got marked in the meantime because its next is no longer the
+    // plain right_node reference
+    if ((*left_node)->next.compare_exchange_strong(
+            right_node, new_node, Ordering::publish,
+            Ordering::publish_failure)) {
+      key_count.add(1);
       return true;
     }
+    stat_counters.add(STAT_CAS_FAILURES);
+    backoff.pause();
   }
 }
 
 /**
  * @brief Remove a key from the list
  *
+ * @param start Node to start the search from
  * @param search_key Key to be removed
  * @return true If the key is successfully removed, false if the key is not
  * found
  */
-template <typename KeyType>
-bool LockFreeList<KeyType>::remove(const KeyType search_key) {
-  LockFreeNode<KeyType> *right_node, *right_node_next, *left_node;
+template <typename KeyType, template <typename, typename> class Reclaim,
+          template <typename> class Alloc, typename Ordering,
+          typename Backoff>
+bool LockFreeList<KeyType, Reclaim, Alloc, Ordering, Backoff>::remove_from(
+    LockFreeNode<KeyType> *start, const KeyType search_key) {
+  typename Reclaimer::Guard guard(reclaimer);
+  LockFreeNode<KeyType> *left_node;
+  return remove_at(start, search_key, &left_node);
+}
+
+/**
+ * @brief Remove a key, the caller is responsible for the Reclaimer::Guard
+ *
+ * @param start Node to start the search from
+ * @param search_key Key to be removed
+ * @param left_node Set to the node before the key, protected by hazard pointer
+ * 0 on return
+ * @return true If the key is successfully removed, false if the key is not
+ * found
+ */
+template <typename KeyType, template <typename, typename> class Reclaim,
+          template <typename> class Alloc, typename Ordering,
+          typename Backoff>
+bool LockFreeList<KeyType, Reclaim, Alloc, Ordering, Backoff>::remove_at(
+    LockFreeNode<KeyType> *start, const KeyType search_key,
+    LockFreeNode<KeyType> **left_node) {
+  LockFreeNode<KeyType> *right_node, *right_node_next;
+  Backoff backoff;
+  stat_counters.add(STAT_OPERATIONS);
 
   while (true) {
-    right_node = search(search_key, &left_node);
+    right_node = search(start, search_key, left_node);
 
-    ASSERT(hp_manager.is_protected(right_node));
+    ASSERT(reclaimer.is_protected(right_node));
     // if the key is not found, return false
     if (right_node == tail || right_node->key != search_key) {
       return false;
     }
 
-    right_node_next = right_node->next.load();
-    hp_manager.protect(right_node_next, 4);
-    if (right_node->next.load() != right_node_next ||
-        right_node->is_deleted()) {
+    // right_node_next is never dereferenced, it can't be unlinked while
+    // right_node (marked below) still points to it
+    right_node_next = right_node->next.load(Ordering::traverse);
+    if (is_marked_reference(right_node_next)) {
       continue;
     }
-    ASSERT(hp_manager.is_protected(right_node));
-    bool expected = false;
-    // Try to mark the node using compare_exchange
-    if (right_node->marked.compare_exchange_strong(expected, true)) {
+    // Try to mark the node, this fails if the link changed since we read it
+    if (right_node->next.compare_exchange_strong(
+            right_node_next, get_marked_reference(right_node_next),
+            Ordering::publish, Ordering::publish_failure)) {
       break;
     }
+    stat_counters.add(STAT_CAS_FAILURES);
+    backoff.pause();
   }
-  ASSERT(hp_manager.is_protected(left_node));
-  // physically remove the node if possible
-  if (left_node->next.compare_exchange_strong(right_node, right_node_next)) {
-    hp_manager.retire_node(right_node);
+  // the key is logically removed once its node is marked
+  key_count.add(-1);
+  ASSERT(reclaimer.is_protected(*left_node));
+  // physically remove the node if possible, otherwise let search() do it
+  if ((*left_node)->next.compare_exchange_strong(right_node, right_node_next,
+                                                 Ordering::publish,
+                                                 Ordering::publish_failure)) {
+    reclaimer.retire_node(right_node);
+  } else {
+    stat_counters.add(STAT_CAS_FAILURES);
+    search(start, search_key, left_node);
   }
 
-  // hp_manager.clear(0);
-  // hp_manager.clear(1);
-  // hp_manager.clear(2);
   return true;
 }
 
 /**
  * @brief Find a key in the list
  *
+ * @param start Node to start the search from
+ * @param search_key Key to be searched
+ * @return true If the key is found, false otherwise
+ */
+template <typename KeyType, template <typename, typename> class Reclaim,
+          template <typename> class Alloc, typename Ordering,
+          typename Backoff>
+bool LockFreeList<KeyType, Reclaim, Alloc, Ordering, Backoff>::find_from(
+    LockFreeNode<KeyType> *start, const KeyType search_key) {
+  typename Reclaimer::Guard guard(reclaimer);
+  LockFreeNode<KeyType> *left_node;
+  return find_at(start, search_key, &left_node);
+}
+
+/**
+ * @brief Find a key, the caller is responsible for the Reclaimer::Guard
+ *
+ * Unlike insert and remove, this doesn't go through search(): marked nodes
+ * are never unlinked here, so a lookup doesn't write to the list. With epoch
+ * based reclamation, marked nodes are simply stepped over. With hazard
+ * pointers, a node reached through a marked node might already be retired,
+ * so in the rare case where a marked node is in the way, the lookup falls
+ * back to search() and helps to unlink it.
+ *
+ * @param start Node to start the search from. If it's marked, the lookup
+ * starts from the head instead
  * @param search_key Key to be searched
+ * @param left_node Set to the last node before the key, protected by hazard
+ * pointer 0 on return
  * @return true If the key is found, false otherwise
  */
-template <typename KeyType>
-bool LockFreeList<KeyType>::find(const KeyType search_key) {
-  LockFreeNode<KeyType> *right_node, *left_node;
-  right_node = search(search_key, &left_node);
-  bool result = right_node != tail && right_node->key == search_key;
-  return result;
+template <typename KeyType, template <typename, typename> class Reclaim,
+          template <typename> class Alloc, typename Ordering,
+          typename Backoff>
+bool LockFreeList<KeyType, Reclaim, Alloc, Ordering, Backoff>::find_at(
+    LockFreeNode<KeyType> *start, const KeyType search_key,
+    LockFreeNode<KeyType> **left_node) {
+  LockFreeNode<KeyType> *prev, *curr, *succ;
+  stat_counters.add(STAT_OPERATIONS);
+retry:
+  prev = start;
+  reclaimer.protect(prev, 0);
+  curr = prev->next.load(Ordering::traverse);
+  // a finger might have been removed since it was checked
+  if (is_marked_reference(curr)) {
+    stat_counters.add(STAT_SEARCH_RESTARTS);
+    start = head;
+    goto retry;
+  }
+
+  while (true) {
+    if (Reclaimer::protects_per_node) {
+      // same validation as in search()
+      reclaimer.protect(curr, 1);
+      if (prev->next.load(Ordering::validate) != curr) {
+        stat_counters.add(STAT_SEARCH_RESTARTS);
+        goto retry;
+      }
+    }
+    if constexpr (!SentinelKeys<KeyType>::bounded) {
+      if (curr == tail) {
+        *left_node = prev;
+        return false;
+      }
+    }
+
+    succ = curr->next.load(Ordering::traverse);
+    if (!(curr->key < search_key)) {
+      *left_node = prev;
+      // a marked node with the key was removed during the lookup
+      return curr->key == search_key && curr != tail &&
+             !is_marked_reference(succ);
+    }
+    if (Reclaimer::protects_per_node && is_marked_reference(succ)) {
+      curr = search(start, search_key, left_node);
+      return curr != tail && curr->key == search_key;
+    }
+    if (is_marked_reference(succ)) {
+      stat_counters.add(STAT_MARKED_SKIPPED);
+    }
+
+    stat_counters.add(STAT_NODES_TRAVERSED);
+    prev = curr;
+    reclaimer.protect(prev, 0);
+    curr = get_unmarked_reference(succ);
+  }
+}
+
+/**
+ * @brief Insert a key that is never going to be removed, or get the node that
+ * already holds it
+ *
+ * @param start Node to start the search from
+ * @param key Key of the sentinel
+ * @note The returned node stays valid after the call only because it's never
+ * removed, remove_from() must never be called with its key
+ * @return LockFreeNode<KeyType>* The node holding the key
+ */
+template <typename KeyType, template <typename, typename> class Reclaim,
+          template <typename> class Alloc, typename Ordering,
+          typename Backoff>
+LockFreeNode<KeyType> *
+LockFreeList<KeyType, Reclaim, Alloc, Ordering, Backoff>::insert_sentinel(
+    LockFreeNode<KeyType> *start, const KeyType key) {
+  typename Reclaimer::Guard guard(reclaimer);
+  LockFreeNode<KeyType> *new_node = nullptr;
+  LockFreeNode<KeyType> *left_node, *right_node;
+  Backoff backoff;
+  stat_counters.add(STAT_OPERATIONS);
+
+  while (true) {
+    right_node = search(start, key, &left_node);
+    if (right_node != tail && right_node->key == key) {
+      if (new_node != nullptr) {
+        Allocator::delete_node(new_node);
+      }
+      return right_node;
+    }
+
+    if (new_node == nullptr) {
+      new_node = Allocator::new_node(key);
+    }
+    new_node->next.store(right_node, Ordering::init);
+    if (left_node->next.compare_exchange_strong(right_node, new_node,
+                                                Ordering::publish,
+                                                Ordering::publish_failure)) {
+      return new_node;
+    }
+    stat_counters.add(STAT_CAS_FAILURES);
+    backoff.pause();
+  }
+}
+
+/**
+ * @brief Insert a sorted range of keys in a single pass over the list
+ *
+ * The search for each key resumes from the node before the previous key
+ * instead of from the head, so a batch of k keys costs one traversal instead
+ * of k. That node is kept protected by hazard pointer 3 while it's used as
+ * the start of the next search.
+ *
+ * @param first Iterator to the first key, in ascending order for a single
+ * pass. A key that isn't after the previous one restarts from the head
+ * @param last Iterator past the last key
+ * @return size_t Number of keys that were inserted
+ */
+template <typename KeyType, template <typename, typename> class Reclaim,
+          template <typename> class Alloc, typename Ordering,
+          typename Backoff>
+template <typename Iterator>
+size_t LockFreeList<KeyType, Reclaim, Alloc, Ordering, Backoff>::insert_batch(
+    Iterator first, Iterator last) {
+  typename Reclaimer::Guard guard(reclaimer);
+  LockFreeNode<KeyType> *start = head;
+  size_t count = 0;
+  for (; first != last; ++first) {
+    // start is still protected by hazard pointer 0 from the previous search
+    start = batch_start(start, *first);
+    reclaimer.protect(start, 3);
+    if (insert_at(start, *first, &start)) {
+      count++;
+    }
+  }
+  return count;
+}
+
+/**
+ * @brief Remove a sorted range of keys in a single pass over the list
+ *
+ * @param first Iterator to the first key, in ascending order for a single
+ * pass. A key that isn't after the previous one restarts from the head
+ * @param last Iterator past the last key
+ * @return size_t Number of keys that were removed
+ */
+template <typename KeyType, template <typename, typename> class Reclaim,
+          template <typename> class Alloc, typename Ordering,
+          typename Backoff>
+template <typename Iterator>
+size_t LockFreeList<KeyType, Reclaim, Alloc, Ordering, Backoff>::remove_batch(
+    Iterator first, Iterator last) {
+  typename Reclaimer::Guard guard(reclaimer);
+  LockFreeNode<KeyType> *start = head;
+  size_t count = 0;
+  for (; first != last; ++first) {
+    start = batch_start(start, *first);
+    reclaimer.protect(start, 3);
+    if (remove_at(start, *first, &start)) {
+      count++;
+    }
+  }
+  return count;
+}
+
+/**
+ * @brief Fill an empty list with a range of keys, in time linear in the number
+ * of keys. The keys are sorted if they aren't already, and linked in segments
+ * by several threads, see bulk_load.h
+ *
+ * @param first Iterator to the first key, duplicates are loaded once
+ * @param last Iterator past the last key
+ * @param num_threads Maximum number of threads building the list, 0 to use one
+ * per hardware thread
+ * @return size_t Number of keys loaded
+ * @note The list must be empty and not used by any other thread yet. The keys
+ * are published with a single store, so threads that start using the list
+ * afterwards see all of them
+ */
+template <typename KeyType, template <typename, typename> class Reclaim,
+          template <typename> class Alloc, typename Ordering,
+          typename Backoff>
+template <typename Iterator>
+size_t LockFreeList<KeyType, Reclaim, Alloc, Ordering, Backoff>::bulk_load(
+    Iterator first, Iterator last, unsigned num_threads) {
+  if (head->next.load() != tail) {
+    throw runtime_error("bulk_load needs an empty list");
+  }
+  vector<KeyType> keys = sorted_bulk_keys<KeyType>(first, last);
+  head->next.store(build_bulk_chain<LockFreeNode<KeyType>, Allocator>(
+      keys, tail, num_threads));
+  key_count.add(static_cast<long>(keys.size()));
+  return keys.size();
+}
+
+/**
+ * @brief Visit every key in [lo, hi] in ascending order
+ *
+ * The whole walk runs inside one Reclaimer::Guard, so it's safe against
+ * concurrent removals. The scan is weakly consistent rather than a snapshot:
+ * every key that is in the list for the whole scan is visited exactly once,
+ * keys inserted or removed during the scan may or may not be, and no key is
+ * visited twice. Marked nodes are never visited. With hazard pointers, a
+ * marked node in the way can't be stepped over, so the walk resumes with
+ * search() after the last visited key.
+ *
+ * @param lo Smallest key to visit
+ * @param hi Largest key to visit
+ * @param visit Called with each key, as visit(const KeyType &)
+ * @note With epoch based reclamation, nothing can be freed while the visitor
+ * runs, so it should be quick
+ */
+template <typename KeyType, template <typename, typename> class Reclaim,
+          template <typename> class Alloc, typename Ordering,
+          typename Backoff>
+template <typename Visitor>
+void LockFreeList<KeyType, Reclaim, Alloc, Ordering,
+                  Backoff>::for_each_in_range(const KeyType lo,
+                                              const KeyType hi,
+                                              Visitor visit) {
+  typename Reclaimer::Guard guard(reclaimer);
+  LockFreeNode<KeyType> *prev, *curr, *succ;
+  stat_counters.add(STAT_OPERATIONS);
+  // the next key to visit is the first one not less than bound, or greater
+  // than bound once a key was visited
+  KeyType bound = lo;
+  bool visited = false;
+
+  prev = head;
+  reclaimer.protect(prev, 0);
+  curr = prev->next.load(Ordering::traverse);
+
+  while (true) {
+    if (Reclaimer::protects_per_node) {
+      // same validation as in search()
+      reclaimer.protect(curr, 1);
+      if (prev->next.load(Ordering::validate) != curr) {
+        goto resume;
+      }
+    }
+    if (curr == tail) {
+      return;
+    }
+
+    succ = curr->next.load(Ordering::traverse);
+    if (is_marked_reference(succ)) {
+      stat_counters.add(STAT_MARKED_SKIPPED);
+      if (Reclaimer::protects_per_node) {
+        goto resume;
+      }
+      curr = get_unmarked_reference(succ);
+      continue;
+    }
+
+    if (hi < curr->key) {
+      return;
+    }
+    if (visited ? bound < curr->key : !(curr->key < bound)) {
+      visit(curr->key);
+      bound = curr->key;
+      visited = true;
+    }
+
+    stat_counters.add(STAT_NODES_TRAVERSED);
+    prev = curr;
+    reclaimer.protect(prev, 0);
+    curr = succ;
+    continue;
+
+  resume:
+    // prev is before bound, search() restarts from the head if it's marked
+    reclaimer.protect(prev, 3);
+    curr = search(prev, bound, &prev);
+  }
+}
+
+/**
+ * @brief Collect every key in [lo, hi] in ascending order, with the same
+ * guarantees as for_each_in_range()
+ *
+ * @param lo Smallest key to collect
+ * @param hi Largest key to collect
+ * @param out The keys are appended to it
+ * @return size_t Number of keys appended
+ */
+template <typename KeyType, template <typename, typename> class Reclaim,
+          template <typename> class Alloc, typename Ordering,
+          typename Backoff>
+size_t LockFreeList<KeyType, Reclaim, Alloc, Ordering, Backoff>::range_query(
+    const KeyType lo, const KeyType hi, vector<KeyType> &out) {
+  size_t size = out.size();
+  for_each_in_range(lo, hi,
+                    [&out](const KeyType &key) { out.push_back(key); });
+  return out.size() - size;
 }
 
 /**
  * @brief A helper function to print the list after operations
  * @note Not thread-safe
  */
-template <typename KeyType> void LockFreeList<KeyType>::print_list() {
+template <typename KeyType, template <typename, typename> class Reclaim,
+          template <typename> class Alloc, typename Ordering,
+          typename Backoff>
+void LockFreeList<KeyType, Reclaim, Alloc, Ordering, Backoff>::print_list() {
   LockFreeNode<KeyType> *current = get_front();
   while (current != tail) {
     if (!current->is_marked()) {
       std::cout << current->key << " -> ";
     }
-    current = current->next.load();
+    current = get_unmarked_reference(current->next.load());
   }
   std::cout << "NULL\n";
 }
 
-template <typename KeyType>
-HazardPointer<LockFreeNode<KeyType>> LockFreeList<KeyType>::hp_manager;
+template <typename KeyType, template <typename, typename> class Reclaim,
+          template <typename> class Alloc, typename Ordering,
+          typename Backoff>
+typename LockFreeList<KeyType, Reclaim, Alloc, Ordering, Backoff>::Reclaimer
+    LockFreeList<KeyType, Reclaim, Alloc, Ordering, Backoff>::reclaimer;
 
 #endif // LOCK_FREE_LIST_H
\ No newline at end of file
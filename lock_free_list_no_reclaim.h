@@ -11,49 +11,129 @@
 #ifndef LOCK_FREE_LIST_NO_RECLAIM_H
 #define LOCK_FREE_LIST_NO_RECLAIM_H
 
+#include "bulk_load.h"
+#include "finger.h"
+#include "list_stats.h"
+#include "marked_pointer.h"
+#include "memory_ordering.h"
+#include "node_pool.h"
+#include "sentinel_keys.h"
+#include "sharded_counter.h"
 #include <atomic>
 #include <iostream>
+#include <stdexcept>
 #include <thread>
 #include <vector>
 using namespace std;
 
 template <typename KeyType> struct LockFreeNoReclaimNode {
   KeyType key;
+  /* the lowest bit of next is used to indicate that the node is logically
+   * deleted (see marked_pointer.h), this makes sure that other threads don't
+   * try to link new nodes after it before we have a chance to physically
+   * delete it. The mark and the link are always changed by the same CAS */
   atomic<LockFreeNoReclaimNode *> next;
-  /* is_deleted is used to indicate that the node is logically deleted, this
-   * makes sure that other threads don't try to access the node before we have a
-   * chance to physically delete them */
-  /* TODO: extra memory usage, could use the last bit of next pointer instead
-    because the LockFreeNoReclaimNode structure is more than 1 byte aligned */
-  atomic<bool> is_deleted;
-  LockFreeNoReclaimNode(KeyType key)
-      : key(key), next(nullptr), is_deleted(false) {}
+  LockFreeNoReclaimNode(KeyType key) : key(key), next(nullptr) {}
 
   /**
    * @brief Helper function to check if the node is marked for deletion
-   * @note The load() function is used to make sure that the value is read
-   * with memory fence
+   * @param order Memory ordering of the load
    * @return Whether the node is marked for deletion
    */
-  bool is_marked() { return is_deleted.load(); }
+  bool is_marked(memory_order order = memory_order_seq_cst) {
+    return is_marked_reference(next.load(order));
+  }
 };
 
-template <typename KeyType> class LockFreeListNoReclaim {
+/**
+ * @brief A lock-free sorted linked list that never frees removed nodes
+ *
+ * @tparam KeyType Type of the keys
+ * @tparam Alloc Node allocator, either HeapAllocator or NodePool
+ * @tparam Ordering Memory ordering of the accesses to the next pointers,
+ * either SeqCstOrdering or AcquireReleaseOrdering (see memory_ordering.h)
+ */
+template <typename KeyType, template <typename> class Alloc = HeapAllocator,
+          typename Ordering = SeqCstOrdering>
+class LockFreeListNoReclaim {
 private:
+  typedef Alloc<LockFreeNoReclaimNode<KeyType>> Allocator;
+
   LockFreeNoReclaimNode<KeyType> *head;
   LockFreeNoReclaimNode<KeyType> *tail;
+  /* contention counters, empty unless LIST_STATS is defined */
+  StatCounters stat_counters;
+  ShardedCounter key_count;
+  /* identifies the list in the fingers of the threads, see finger.h */
+  const uint64_t list_id = next_list_id();
+  bool finger_enabled = false;
+
+  static Finger<LockFreeNoReclaimNode<KeyType>> &local_finger() {
+    static thread_local Finger<LockFreeNoReclaimNode<KeyType>> finger;
+    return finger;
+  }
+
+  /**
+   * @brief Pick the node an operation on the key starts from: the calling
+   * thread's finger if it's enabled, unmarked and before the key, the head
+   * otherwise. Nodes are only freed with the list, so the finger is always
+   * safe to read
+   */
+  LockFreeNoReclaimNode<KeyType> *finger_start(const KeyType &key) {
+    Finger<LockFreeNoReclaimNode<KeyType>> &finger = local_finger();
+    if (!finger_enabled || finger.list_id != list_id ||
+        !(finger.node->key < key) ||
+        finger.node->is_marked(Ordering::traverse)) {
+      return head;
+    }
+    return finger.node;
+  }
 
+  void save_finger(LockFreeNoReclaimNode<KeyType> *node) {
+    if (finger_enabled && node != head) {
+      local_finger().list_id = list_id;
+      local_finger().node = node;
+    }
+  }
+
+  /**
+   * @brief Whether a traversal looking for the key has to go past the node
+   */
+  bool before_key(LockFreeNoReclaimNode<KeyType> *node,
+                  const KeyType &key) const {
+    if constexpr (SentinelKeys<KeyType>::bounded) {
+      // the tail's key isn't less than any key
+      return node->key < key;
+    } else {
+      return node != tail && node->key < key;
+    }
+  }
+
+  /**
+   * @brief Node the next key of a batch is searched from: where the previous
+   * key's search stopped, or the head if the batch isn't sorted there
+   */
   LockFreeNoReclaimNode<KeyType> *
-  search(const KeyType key, LockFreeNoReclaimNode<KeyType> **left_node);
+  batch_start(LockFreeNoReclaimNode<KeyType> *start,
+              const KeyType &key) const {
+    return start == head || start->key < key ? start : head;
+  }
+
+  LockFreeNoReclaimNode<KeyType> *
+  search(LockFreeNoReclaimNode<KeyType> *start, const KeyType key,
+         LockFreeNoReclaimNode<KeyType> **left_node);
+  bool insert_at(LockFreeNoReclaimNode<KeyType> *start, const KeyType key,
+                 LockFreeNoReclaimNode<KeyType> **left_node);
+  bool remove_at(LockFreeNoReclaimNode<KeyType> *start, const KeyType key,
+                 LockFreeNoReclaimNode<KeyType> **left_node);
 
 public:
   /**
    * @brief Construct a new Lock Free List object
    */
   LockFreeListNoReclaim() {
-    // use default constructor for KeyType
-    head = new LockFreeNoReclaimNode<KeyType>(KeyType{});
-    tail = new LockFreeNoReclaimNode<KeyType>(KeyType{});
+    head = Allocator::new_node(SentinelKeys<KeyType>::head_key());
+    tail = Allocator::new_node(SentinelKeys<KeyType>::tail_key());
     head->next.store(tail);
   }
 
@@ -63,8 +143,9 @@ public:
   ~LockFreeListNoReclaim() {
     LockFreeNoReclaimNode<KeyType> *curr = head;
     while (curr != nullptr) {
-      LockFreeNoReclaimNode<KeyType> *next = curr->next.load();
-      delete curr;
+      LockFreeNoReclaimNode<KeyType> *next =
+          get_unmarked_reference(curr->next.load());
+      Allocator::delete_node(curr);
       curr = next;
     }
   }
@@ -93,16 +174,77 @@ public:
    */
   LockFreeNoReclaimNode<KeyType> *get_tail() { return tail; }
 
-  bool insert(const KeyType key);
-  bool remove(const KeyType key);
-  bool find(const KeyType search_key);
+  bool insert(const KeyType key) {
+    LockFreeNoReclaimNode<KeyType> *left_node;
+    bool inserted = insert_at(finger_start(key), key, &left_node);
+    save_finger(left_node);
+    return inserted;
+  }
+  bool remove(const KeyType key) {
+    LockFreeNoReclaimNode<KeyType> *left_node;
+    bool removed = remove_at(finger_start(key), key, &left_node);
+    save_finger(left_node);
+    return removed;
+  }
+  bool find(const KeyType search_key) { return contains(search_key); }
+  bool contains(const KeyType search_key);
+
+  /**
+   * @brief Let insert(), remove() and find() start from the node the calling
+   * thread's previous operation stopped before, see LockFreeList. Off by
+   * default
+   * @note Must be set before the list is shared between threads
+   */
+  void enable_finger(bool enabled) { finger_enabled = enabled; }
+
+  template <typename Iterator>
+  size_t insert_batch(Iterator first, Iterator last);
+  template <typename Iterator>
+  size_t remove_batch(Iterator first, Iterator last);
+  template <typename Iterator>
+  size_t bulk_load(Iterator first, Iterator last, unsigned num_threads = 0);
+
+  template <typename Visitor>
+  void for_each_in_range(const KeyType lo, const KeyType hi, Visitor visit);
+  size_t range_query(const KeyType lo, const KeyType hi,
+                     vector<KeyType> &out);
   void print_list();
+
+  /**
+   * @brief Number of keys in the list, exact when no operation is in progress
+   */
+  size_t size() const {
+    long count = key_count.read();
+    return count > 0 ? static_cast<size_t>(count) : 0;
+  }
+
+  /**
+   * @brief Estimate of the number of keys, see ShardedCounter::approximate()
+   */
+  size_t approximate_size() const {
+    long count = key_count.approximate();
+    return count > 0 ? static_cast<size_t>(count) : 0;
+  }
+
+  /**
+   * @brief Snapshot of the contention counters, all zero unless LIST_STATS is
+   * defined. Removed nodes are never retired, so the retired and freed counts
+   * are always zero
+   *
+   * @return ListStats The counters
+   */
+  ListStats stats() const {
+    return make_list_stats(stat_counters, StatCounters());
+  }
 };
 
-template <typename KeyType>
+template <typename KeyType, template <typename> class Alloc,
+          typename Ordering>
 /**
  * @brief Search for a spot to insert the key
  *
+ * @param start Node to start from, must be before the key. If it's marked, the
+ * search starts from the head instead
  * @param key Key to be inserted
  * @param left_node Pointer to be modified to point to the node before the
  * key
@@ -112,45 +254,59 @@ template <typename KeyType>
  * @return LockFreeNoReclaimNode<KeyType>* The node to the right where the key
  * should be inserted
  */
-LockFreeNoReclaimNode<KeyType> *LockFreeListNoReclaim<KeyType>::search(
-    const KeyType key, LockFreeNoReclaimNode<KeyType> **left_node) {
-  LockFreeNoReclaimNode<KeyType> *left_node_next;
+LockFreeNoReclaimNode<KeyType> *
+LockFreeListNoReclaim<KeyType, Alloc, Ordering>::search(
+    LockFreeNoReclaimNode<KeyType> *start, const KeyType key,
+    LockFreeNoReclaimNode<KeyType> **left_node) {
+  LockFreeNoReclaimNode<KeyType> *left_node_next = nullptr;
   LockFreeNoReclaimNode<KeyType> *right_node;
 
   while (true) {
-    LockFreeNoReclaimNode<KeyType> *t = head;
-    LockFreeNoReclaimNode<KeyType> *t_next = head->next.load();
+    LockFreeNoReclaimNode<KeyType> *t = start;
+    LockFreeNoReclaimNode<KeyType> *t_next =
+        start->next.load(Ordering::traverse);
+    // a batch resumes from the previous key's left_node, which might have been
+    // removed since
+    if (is_marked_reference(t_next)) {
+      stat_counters.add(STAT_SEARCH_RESTARTS);
+      start = head;
+      continue;
+    }
 
     // 1. Find left_node and right_node (right node might be marked)
     do {
-      /* unlike the paper, where the references are stored in the next
-       * pointer, we already have a dedicated field for mark checking */
-      if (!t->is_marked()) {
+      // the mark of t is stored in t_next, so one load gives both
+      if (!is_marked_reference(t_next)) {
         *left_node = t;
         left_node_next = t_next;
+      } else {
+        stat_counters.add(STAT_MARKED_SKIPPED);
       }
 
-      // NOTE: unlike the paper, we don't need get_marked_reference()
-      // because the pointer is not changed in this implementation
-      t = t_next;
+      t = get_unmarked_reference(t_next);
+      stat_counters.add(STAT_NODES_TRAVERSED);
 
-      if (t == tail) {
-        break;
+      // with bounded keys, the key comparison below stops at the tail
+      if constexpr (!SentinelKeys<KeyType>::bounded) {
+        if (t == tail) {
+          break;
+        }
       }
 
       // t_next updated after the break statement because if we break here,
       // we no longer need to update left_node_next
-      t_next = t->next.load();
+      t_next = t->next.load(Ordering::traverse);
 
       // keep looping until we find a right node that is not marked
-    } while (t->is_marked() || t->key < key);
+    } while (is_marked_reference(t_next) || t->key < key);
 
     right_node = t;
 
     // 2. Check if the nodes are adjacent
     if (left_node_next == right_node) {
       // if right node is marked, search again
-      if (right_node != tail && right_node->is_marked()) {
+      if (right_node != tail && right_node->is_marked(Ordering::traverse)) {
+        stat_counters.add(STAT_SEARCH_RESTARTS);
         continue;
       } else {
         // found the right node
@@ -161,104 +317,296 @@ LockFreeNoReclaimNode<KeyType> *LockFreeListNoReclaim<KeyType>::search(
     // 3. Remove one or more marked nodes from left to right node
     // this is run many times until we find the right node
     if ((*left_node)
-            ->next.compare_exchange_strong(left_node_next, right_node)) {
+            ->next.compare_exchange_strong(left_node_next, right_node,
+                                           Ordering::publish,
+                                           Ordering::publish_failure)) {
+      stat_counters.add(STAT_HELPING_UNLINKS);
 
-      if (right_node != tail && right_node->is_marked()) {
+      if (right_node != tail && right_node->is_marked(Ordering::traverse)) {
+        stat_counters.add(STAT_SEARCH_RESTARTS);
         continue;
       } else {
         return right_node;
       }
     }
+    stat_counters.add(STAT_CAS_FAILURES);
+    stat_counters.add(STAT_SEARCH_RESTARTS);
   }
 }
 
-template <typename KeyType>
+template <typename KeyType, template <typename> class Alloc,
+          typename Ordering>
 /**
  * @brief Insert a key into the list sorted by key
  *
+ * @param start Node to start the search from
  * @param key Key to be inserted
+ * @param left_node Set to the node before the key
  * @return true If the key is successfully inserted, false otherwise
  */
-bool LockFreeListNoReclaim<KeyType>::insert(const KeyType key) {
-  LockFreeNoReclaimNode<KeyType> *new_node =
-      new LockFreeNoReclaimNode<KeyType>(key);
-  LockFreeNoReclaimNode<KeyType> *left_node, *right_node;
+bool LockFreeListNoReclaim<KeyType, Alloc, Ordering>::insert_at(
+    LockFreeNoReclaimNode<KeyType> *start, const KeyType key,
+    LockFreeNoReclaimNode<KeyType> **left_node) {
+  // the node is only allocated once we know the key isn't in the list, and
+  // it's reused if the CAS fails
+  LockFreeNoReclaimNode<KeyType> *new_node = nullptr;
+  LockFreeNoReclaimNode<KeyType> *right_node;
+  stat_counters.add(STAT_OPERATIONS);
 
   while (true) {
-    right_node = search(key, &left_node);
+    right_node = search(start, key, left_node);
 
-    // duplicate key, release allocated memory
+    // duplicate key, release allocated memory. The node was never published,
+    // so it can be freed right away
     if (right_node != tail && right_node->key == key) {
+      if (new_node != nullptr) {
+        Allocator::delete_node(new_node);
+      }
       return false;
     }
 
-    new_node->next.store(right_node);
+    if (new_node == nullptr) {
+      new_node = Allocator::new_node(key);
+    }
+    new_node->next.store(right_node, Ordering::init);
 
     // loop back until we get a chance to insert the new node
-    if (left_node->next.compare_exchange_strong(right_node, new_node)) {
+    if ((*left_node)->next.compare_exchange_strong(
+            right_node, new_node, Ordering::publish,
+            Ordering::publish_failure)) {
+      key_count.add(1);
       return true;
     }
+    stat_counters.add(STAT_CAS_FAILURES);
   }
 }
 
-template <typename KeyType>
+template <typename KeyType, template <typename> class Alloc,
+          typename Ordering>
 /**
  * @brief Remove a key from the list
  *
+ * @param start Node to start the search from
  * @param search_key Key to be removed
+ * @param left_node Set to the node before the key
  * @return true If the key is successfully removed, false if the key is not
  * found
  */
-bool LockFreeListNoReclaim<KeyType>::remove(const KeyType search_key) {
-  LockFreeNoReclaimNode<KeyType> *right_node, *right_node_next, *left_node;
+bool LockFreeListNoReclaim<KeyType, Alloc, Ordering>::remove_at(
+    LockFreeNoReclaimNode<KeyType> *start, const KeyType search_key,
+    LockFreeNoReclaimNode<KeyType> **left_node) {
+  LockFreeNoReclaimNode<KeyType> *right_node, *right_node_next;
+  stat_counters.add(STAT_OPERATIONS);
 
   while (true) {
-    right_node = search(search_key, &left_node);
+    right_node = search(start, search_key, left_node);
     // if the key is not found, return false
     if (right_node == tail || right_node->key != search_key) {
       return false;
     }
 
-    right_node_next = right_node->next.load();
-    bool expected = false;
-    // Try to mark the node using compare_exchange
-    if (right_node->is_deleted.compare_exchange_strong(expected, true)) {
+    right_node_next = right_node->next.load(Ordering::traverse);
+    if (is_marked_reference(right_node_next)) {
+      continue;
+    }
+    // Try to mark the node, this fails if the link changed since we read it
+    if (right_node->next.compare_exchange_strong(
+            right_node_next, get_marked_reference(right_node_next),
+            Ordering::publish, Ordering::publish_failure)) {
       break;
     }
+    stat_counters.add(STAT_CAS_FAILURES);
   }
-
-  // physically remove the node if possible
-  if (left_node->next.compare_exchange_strong(right_node, right_node_next)) {
+  key_count.add(-1);
+
+  // physically remove the node if possible, otherwise let search() do it
+  if (!(*left_node)
+           ->next.compare_exchange_strong(right_node, right_node_next,
+                                          Ordering::publish,
+                                          Ordering::publish_failure)) {
+    stat_counters.add(STAT_CAS_FAILURES);
+    search(start, search_key, left_node);
   }
 
   return true;
 }
 
-template <typename KeyType>
+template <typename KeyType, template <typename> class Alloc,
+          typename Ordering>
 /**
  * @brief Find a key in the list
  *
+ * Marked nodes are stepped over instead of unlinked, so a lookup only reads
+ * the list. Nodes are never freed, so every node reached stays valid.
+ *
  * @param search_key Key to be searched
  * @return true If the key is found, false otherwise
  */
-bool LockFreeListNoReclaim<KeyType>::find(const KeyType search_key) {
-  LockFreeNoReclaimNode<KeyType> *right_node, *left_node;
-  right_node = search(search_key, &left_node);
-  return right_node != tail && right_node->key == search_key;
+bool LockFreeListNoReclaim<KeyType, Alloc, Ordering>::contains(
+    const KeyType search_key) {
+  LockFreeNoReclaimNode<KeyType> *prev = finger_start(search_key);
+  LockFreeNoReclaimNode<KeyType> *curr = get_unmarked_reference(
+      prev->next.load(Ordering::traverse));
+  stat_counters.add(STAT_OPERATIONS);
+  while (before_key(curr, search_key)) {
+    LockFreeNoReclaimNode<KeyType> *succ = curr->next.load(Ordering::traverse);
+    if (is_marked_reference(succ)) {
+      stat_counters.add(STAT_MARKED_SKIPPED);
+    }
+    stat_counters.add(STAT_NODES_TRAVERSED);
+    prev = curr;
+    curr = get_unmarked_reference(succ);
+  }
+  save_finger(prev);
+  // a marked node with the key was removed during the lookup
+  return curr != tail && curr->key == search_key &&
+         !curr->is_marked(Ordering::traverse);
+}
+
+template <typename KeyType, template <typename> class Alloc,
+          typename Ordering>
+template <typename Iterator>
+/**
+ * @brief Insert a sorted range of keys in a single pass over the list. The
+ * search for each key resumes from the node before the previous key instead of
+ * from the head
+ *
+ * @param first Iterator to the first key, in ascending order for a single
+ * pass. A key that isn't after the previous one restarts from the head
+ * @param last Iterator past the last key
+ * @return size_t Number of keys that were inserted
+ */
+size_t LockFreeListNoReclaim<KeyType, Alloc, Ordering>::insert_batch(
+    Iterator first, Iterator last) {
+  LockFreeNoReclaimNode<KeyType> *start = head;
+  size_t count = 0;
+  for (; first != last; ++first) {
+    start = batch_start(start, *first);
+    if (insert_at(start, *first, &start)) {
+      count++;
+    }
+  }
+  return count;
+}
+
+template <typename KeyType, template <typename> class Alloc,
+          typename Ordering>
+template <typename Iterator>
+/**
+ * @brief Remove a sorted range of keys in a single pass over the list
+ *
+ * @param first Iterator to the first key, in ascending order for a single
+ * pass. A key that isn't after the previous one restarts from the head
+ * @param last Iterator past the last key
+ * @return size_t Number of keys that were removed
+ */
+size_t LockFreeListNoReclaim<KeyType, Alloc, Ordering>::remove_batch(
+    Iterator first, Iterator last) {
+  LockFreeNoReclaimNode<KeyType> *start = head;
+  size_t count = 0;
+  for (; first != last; ++first) {
+    start = batch_start(start, *first);
+    if (remove_at(start, *first, &start)) {
+      count++;
+    }
+  }
+  return count;
+}
+
+template <typename KeyType, template <typename> class Alloc,
+          typename Ordering>
+template <typename Iterator>
+/**
+ * @brief Fill an empty list with a range of keys in linear time, see
+ * LockFreeList::bulk_load()
+ *
+ * @param first Iterator to the first key, duplicates are loaded once
+ * @param last Iterator past the last key
+ * @param num_threads Maximum number of threads building the list, 0 to use one
+ * per hardware thread
+ * @return size_t Number of keys loaded
+ * @note The list must be empty and not used by any other thread yet
+ */
+size_t LockFreeListNoReclaim<KeyType, Alloc, Ordering>::bulk_load(
+    Iterator first, Iterator last, unsigned num_threads) {
+  if (head->next.load() != tail) {
+    throw runtime_error("bulk_load needs an empty list");
+  }
+  vector<KeyType> keys = sorted_bulk_keys<KeyType>(first, last);
+  head->next.store(build_bulk_chain<LockFreeNoReclaimNode<KeyType>, Allocator>(
+      keys, tail, num_threads));
+  key_count.add(static_cast<long>(keys.size()));
+  return keys.size();
+}
+
+template <typename KeyType, template <typename> class Alloc,
+          typename Ordering>
+template <typename Visitor>
+/**
+ * @brief Visit every key in [lo, hi] in ascending order
+ *
+ * Nodes are never freed, so the walk needs no protection. Like contains(), it
+ * steps over marked nodes without unlinking them. Every key that is in the
+ * list for the whole scan is visited, keys inserted or removed during the
+ * scan may or may not be.
+ *
+ * @param lo Smallest key to visit
+ * @param hi Largest key to visit
+ * @param visit Called with each key, as visit(const KeyType &)
+ */
+void LockFreeListNoReclaim<KeyType, Alloc, Ordering>::for_each_in_range(
+    const KeyType lo, const KeyType hi, Visitor visit) {
+  LockFreeNoReclaimNode<KeyType> *curr =
+      get_unmarked_reference(head->next.load(Ordering::traverse));
+  stat_counters.add(STAT_OPERATIONS);
+  while (before_key(curr, lo)) {
+    stat_counters.add(STAT_NODES_TRAVERSED);
+    curr = get_unmarked_reference(curr->next.load(Ordering::traverse));
+  }
+  while (curr != tail && !(hi < curr->key)) {
+    LockFreeNoReclaimNode<KeyType> *succ = curr->next.load(Ordering::traverse);
+    if (!is_marked_reference(succ)) {
+      visit(curr->key);
+    } else {
+      stat_counters.add(STAT_MARKED_SKIPPED);
+    }
+    stat_counters.add(STAT_NODES_TRAVERSED);
+    curr = get_unmarked_reference(succ);
+  }
+}
+
+template <typename KeyType, template <typename> class Alloc,
+          typename Ordering>
+/**
+ * @brief Collect every key in [lo, hi] in ascending order, with the same
+ * guarantees as for_each_in_range()
+ *
+ * @param lo Smallest key to collect
+ * @param hi Largest key to collect
+ * @param out The keys are appended to it
+ * @return size_t Number of keys appended
+ */
+size_t LockFreeListNoReclaim<KeyType, Alloc, Ordering>::range_query(
+    const KeyType lo, const KeyType hi, vector<KeyType> &out) {
+  size_t size = out.size();
+  for_each_in_range(lo, hi,
+                    [&out](const KeyType &key) { out.push_back(key); });
+  return out.size() - size;
 }
 
-template <typename KeyType>
+template <typename KeyType, template <typename> class Alloc,
+          typename Ordering>
 /**
  * @brief A helper function to print the list after operations
  * @note Not thread-safe
  */
-void LockFreeListNoReclaim<KeyType>::print_list() {
+void LockFreeListNoReclaim<KeyType, Alloc, Ordering>::print_list() {
   LockFreeNoReclaimNode<KeyType> *current = get_front();
   while (current != tail) {
     if (!current->is_marked()) {
       std::cout << current->key << " -> ";
     }
-    current = current->next.load();
+    current = get_unmarked_reference(current->next.load());
   }
   std::cout << "NULL\n";
 }
@@ -0,0 +1,387 @@
+/**
+ * @file lock_free_skip_list.h
+ * @author Sihan Zhuang (sihanzhu)
+ * @brief This file contains the implementation of a lock-free skip list. It
+ * applies the search/mark/unlink protocol of the lock-free linked list at every
+ * level, so the expected cost of an operation is O(log n) instead of O(n).
+ * @note The implementation follows the lock-free skip list in The Art of
+ * Multiprocessor Programming by Herlihy and Shavit (itself based on Fraser's).
+ * Nodes are reclaimed with EpochReclaimer: a hazard pointer scheme would need
+ * a hazard pointer for every pred and succ of every level.
+ */
+
+#ifndef LOCK_FREE_SKIP_LIST_H
+#define LOCK_FREE_SKIP_LIST_H
+
+#include "epoch_reclaimer.h"
+#include "marked_pointer.h"
+#include "node_pool.h"
+#include "sharded_counter.h"
+#include <atomic>
+#include <iostream>
+#include <random>
+#include <thread>
+using namespace std;
+
+/* with a promotion probability of 1/4, 12 levels are enough for 4^12 keys */
+static constexpr int SKIP_LIST_MAX_LEVEL = 12;
+
+template <typename KeyType> struct LockFreeSkipNode {
+  KeyType key;
+  int top_level;
+  /* the inserter and the remover each hold a reference, whoever drops the
+   * last one retires the node. Before that, the inserter might still link the
+   * node at an upper level after the remover unlinked it everywhere else */
+  atomic<int> refs;
+  /* next[i] is the successor at level i, the lowest bit of each one is the
+   * logical-delete mark of that level (see marked_pointer.h). A node is in
+   * the set if and only if next[0] is unmarked */
+  atomic<LockFreeSkipNode *> next[SKIP_LIST_MAX_LEVEL];
+
+  LockFreeSkipNode(KeyType key, int top_level)
+      : key(key), top_level(top_level), refs(2) {
+    for (auto &n : next)
+      n.store(nullptr);
+  }
+
+  /**
+   * @brief Helper function to check if the node is marked for deletion
+   * @return Whether the node is marked for deletion
+   */
+  bool is_marked() { return is_marked_reference(next[0].load()); }
+};
+
+/**
+ * @brief A lock-free skip list based set
+ *
+ * @tparam KeyType Type of the keys
+ * @tparam Alloc Node allocator, either HeapAllocator or NodePool
+ */
+template <typename KeyType, template <typename> class Alloc = HeapAllocator>
+class LockFreeSkipList {
+private:
+  typedef LockFreeSkipNode<KeyType> Node;
+  typedef Alloc<Node> Allocator;
+  typedef EpochReclaimer<Node, Allocator> Reclaimer;
+
+  Node *head;
+  Node *tail;
+  static Reclaimer reclaimer;
+  ShardedCounter key_count;
+
+  bool search(const KeyType key, Node **preds, Node **succs);
+  void release(Node *node);
+  static int random_level();
+
+public:
+  /**
+   * @brief Construct a new Lock Free Skip List object
+   */
+  LockFreeSkipList() {
+    // use default constructor for KeyType
+    head = Allocator::new_node(KeyType{}, SKIP_LIST_MAX_LEVEL);
+    tail = Allocator::new_node(KeyType{}, SKIP_LIST_MAX_LEVEL);
+    for (auto &n : head->next)
+      n.store(tail);
+  }
+
+  /**
+   * @brief Destroy the Lock Free Skip List object
+   * @note Removed nodes are unlinked from level 0 before they are retired, so
+   * every node still reachable at level 0 is owned by the list
+   */
+  ~LockFreeSkipList() {
+    Node *curr = head;
+    while (curr != nullptr) {
+      Node *next = get_unmarked_reference(curr->next[0].load());
+      Allocator::delete_node(curr);
+      curr = next;
+    }
+  }
+
+  /**
+   * @brief Helper function to get the front of the list. The front is the first
+   * node after the head at the lowest level
+   *
+   * @return LockFreeSkipNode<KeyType>* The front of the list
+   */
+  Node *get_front() { return get_unmarked_reference(head->next[0].load()); }
+
+  Node *get_next(Node *node) {
+    return get_unmarked_reference(node->next[0].load());
+  }
+
+  Node *get_tail() { return tail; }
+
+  bool insert(const KeyType key);
+  bool remove(const KeyType key);
+  bool find(const KeyType search_key);
+  bool contains(const KeyType search_key) { return find(search_key); }
+  void print_list();
+
+  /**
+   * @brief Number of keys in the list, exact when no operation is in progress
+   */
+  size_t size() const {
+    long count = key_count.read();
+    return count > 0 ? static_cast<size_t>(count) : 0;
+  }
+
+  /**
+   * @brief Estimate of the number of keys, see ShardedCounter::approximate()
+   */
+  size_t approximate_size() const {
+    long count = key_count.approximate();
+    return count > 0 ? static_cast<size_t>(count) : 0;
+  }
+};
+
+/**
+ * @brief Pick the number of levels of a new node, each extra level is taken
+ * with a probability of 1/4
+ *
+ * @return int The number of levels, between 1 and SKIP_LIST_MAX_LEVEL
+ */
+template <typename KeyType, template <typename> class Alloc>
+int LockFreeSkipList<KeyType, Alloc>::random_level() {
+  static thread_local minstd_rand rng(
+      hash<thread::id>()(this_thread::get_id()));
+  int level = 1;
+  while (level < SKIP_LIST_MAX_LEVEL && (rng() & 3) == 0) {
+    level++;
+  }
+  return level;
+}
+
+/**
+ * @brief Search for the position of the key at every level
+ *
+ * At each level, this is the search of the lock-free linked list: marked nodes
+ * met on the way are unlinked, and the search restarts from the head if an
+ * unlink fails.
+ *
+ * @param key Key to be searched
+ * @param preds Filled with the last node before the key at every level
+ * @param succs Filled with the first node not before the key at every level
+ * @note Must be called inside a Reclaimer::Guard
+ * @return true If an unmarked node with the key is in the list
+ */
+template <typename KeyType, template <typename> class Alloc>
+bool LockFreeSkipList<KeyType, Alloc>::search(const KeyType key, Node **preds,
+                                              Node **succs) {
+  Node *pred, *curr, *succ;
+retry:
+  pred = head;
+  for (int level = SKIP_LIST_MAX_LEVEL - 1; level >= 0; --level) {
+    curr = get_unmarked_reference(pred->next[level].load());
+    while (curr != tail) {
+      succ = curr->next[level].load();
+      // curr is logically deleted at this level, help to unlink it
+      while (is_marked_reference(succ)) {
+        succ = get_unmarked_reference(succ);
+        Node *expected = curr;
+        if (!pred->next[level].compare_exchange_strong(expected, succ)) {
+          goto retry;
+        }
+        curr = succ;
+        if (curr == tail) {
+          break;
+        }
+        succ = curr->next[level].load();
+      }
+      if (curr == tail || !(curr->key < key)) {
+        break;
+      }
+      pred = curr;
+      curr = succ;
+    }
+    preds[level] = pred;
+    succs[level] = curr;
+  }
+  return succs[0] != tail && succs[0]->key == key;
+}
+
+/**
+ * @brief Drop one of the two references to a node and retire it with the last
+ * one
+ *
+ * @param node Node whose insert or remove is finished
+ */
+template <typename KeyType, template <typename> class Alloc>
+void LockFreeSkipList<KeyType, Alloc>::release(Node *node) {
+  if (node->refs.fetch_sub(1) == 1) {
+    reclaimer.retire_node(node);
+  }
+}
+
+/**
+ * @brief Insert a key into the skip list
+ *
+ * The node is linked at level 0 first, which is when it joins the set, and
+ * then level by level upwards. Linking stops early if the node gets removed
+ * in the meantime.
+ *
+ * @param key Key to be inserted
+ * @return true If the key is successfully inserted, false otherwise
+ */
+template <typename KeyType, template <typename> class Alloc>
+bool LockFreeSkipList<KeyType, Alloc>::insert(const KeyType key) {
+  typename Reclaimer::Guard guard(reclaimer);
+  Node *preds[SKIP_LIST_MAX_LEVEL], *succs[SKIP_LIST_MAX_LEVEL];
+  // the node is only allocated once we know the key isn't in the list, and
+  // it's reused if the CAS fails
+  Node *new_node = nullptr;
+
+  while (true) {
+    if (search(key, preds, succs)) {
+      // the node was never published, it can be freed right away
+      if (new_node != nullptr) {
+        Allocator::delete_node(new_node);
+      }
+      return false;
+    }
+
+    if (new_node == nullptr) {
+      new_node = Allocator::new_node(key, random_level());
+    }
+    for (int level = 0; level < new_node->top_level; ++level) {
+      new_node->next[level].store(succs[level]);
+    }
+
+    Node *expected = succs[0];
+    if (preds[0]->next[0].compare_exchange_strong(expected, new_node)) {
+      break;
+    }
+  }
+  key_count.add(1);
+
+  for (int level = 1; level < new_node->top_level; ++level) {
+    while (true) {
+      // point the new node at the current successor, unless a remover has
+      // marked this level already
+      Node *next = new_node->next[level].load();
+      if (is_marked_reference(next)) {
+        goto done;
+      }
+      if (next != succs[level] &&
+          !new_node->next[level].compare_exchange_strong(next, succs[level])) {
+        goto done;
+      }
+      Node *expected = succs[level];
+      if (preds[level]->next[level].compare_exchange_strong(expected,
+                                                            new_node)) {
+        break;
+      }
+      // the position changed, search again and give up if the node is gone
+      search(key, preds, succs);
+      if (succs[0] != new_node) {
+        goto done;
+      }
+    }
+  }
+
+done:
+  // a remover may have marked the node after we linked a level, it might
+  // have missed that level when it cleaned up
+  if (new_node->is_marked()) {
+    search(key, preds, succs);
+  }
+  release(new_node);
+  return true;
+}
+
+/**
+ * @brief Remove a key from the skip list
+ *
+ * All the levels are marked from the top down. Whoever marks level 0 removed
+ * the key, and searches once more to unlink the node at every level.
+ *
+ * @param key Key to be removed
+ * @return true If the key is successfully removed, false if the key is not
+ * found
+ */
+template <typename KeyType, template <typename> class Alloc>
+bool LockFreeSkipList<KeyType, Alloc>::remove(const KeyType key) {
+  typename Reclaimer::Guard guard(reclaimer);
+  Node *preds[SKIP_LIST_MAX_LEVEL], *succs[SKIP_LIST_MAX_LEVEL];
+
+  if (!search(key, preds, succs)) {
+    return false;
+  }
+  Node *victim = succs[0];
+
+  for (int level = victim->top_level - 1; level >= 1; --level) {
+    Node *succ = victim->next[level].load();
+    while (!is_marked_reference(succ)) {
+      victim->next[level].compare_exchange_strong(succ,
+                                                  get_marked_reference(succ));
+    }
+  }
+
+  Node *succ = victim->next[0].load();
+  while (!is_marked_reference(succ)) {
+    if (victim->next[0].compare_exchange_strong(succ,
+                                                get_marked_reference(succ))) {
+      key_count.add(-1);
+      // physically remove the node from every level
+      search(key, preds, succs);
+      release(victim);
+      return true;
+    }
+  }
+  // another thread removed it first
+  return false;
+}
+
+/**
+ * @brief Find a key in the skip list
+ *
+ * Unlike search(), marked nodes are stepped over instead of unlinked, so a
+ * lookup only reads the list.
+ *
+ * @param search_key Key to be searched
+ * @return true If the key is found, false otherwise
+ */
+template <typename KeyType, template <typename> class Alloc>
+bool LockFreeSkipList<KeyType, Alloc>::find(const KeyType search_key) {
+  typename Reclaimer::Guard guard(reclaimer);
+  Node *pred = head, *curr = nullptr, *succ;
+  for (int level = SKIP_LIST_MAX_LEVEL - 1; level >= 0; --level) {
+    curr = get_unmarked_reference(pred->next[level].load());
+    while (curr != tail) {
+      succ = curr->next[level].load();
+      if (is_marked_reference(succ)) {
+        curr = get_unmarked_reference(succ);
+      } else if (curr->key < search_key) {
+        pred = curr;
+        curr = get_unmarked_reference(succ);
+      } else {
+        break;
+      }
+    }
+  }
+  // curr was unmarked at level 0 when it was read
+  return curr != tail && curr->key == search_key;
+}
+
+/**
+ * @brief A helper function to print the list after operations
+ * @note Not thread-safe
+ */
+template <typename KeyType, template <typename> class Alloc>
+void LockFreeSkipList<KeyType, Alloc>::print_list() {
+  Node *current = get_front();
+  while (current != tail) {
+    if (!current->is_marked()) {
+      std::cout << current->key << " -> ";
+    }
+    current = get_next(current);
+  }
+  std::cout << "NULL\n";
+}
+
+template <typename KeyType, template <typename> class Alloc>
+typename LockFreeSkipList<KeyType, Alloc>::Reclaimer
+    LockFreeSkipList<KeyType, Alloc>::reclaimer;
+
+#endif // LOCK_FREE_SKIP_LIST_H
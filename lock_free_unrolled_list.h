@@ -0,0 +1,590 @@
+/**
+ * @file lock_free_unrolled_list.h
+ * @author Sihan Zhuang (sihanzhu)
+ * @brief This file contains the implementation of a lock-free unrolled linked
+ * list, where every node holds a small sorted block of keys. A search touches
+ * one node per block instead of one per key, so large sets cost a fraction of
+ * the cache misses of LockFreeList.
+ * @note Nodes are copy-on-write: the keys of a published node never change.
+ * An update builds a replacement (one node, or two when the block splits) and
+ * commits it with a single CAS on the old node's next pointer, which marks the
+ * old node and points it at the replacement. This is the marking protocol of
+ * lock_free_list.h, with the replacement standing in for the successor of a
+ * deleted node, and unlinking works the same way. Two neighbouring blocks are
+ * merged (see help_absorb()) without locks either. Nodes are reclaimed with
+ * EpochReclaimer.
+ */
+
+#ifndef LOCK_FREE_UNROLLED_LIST_H
+#define LOCK_FREE_UNROLLED_LIST_H
+
+#include "epoch_reclaimer.h"
+#include "marked_pointer.h"
+#include "node_pool.h"
+#include "sharded_counter.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <type_traits>
+using namespace std;
+
+/* bits of a next pointer on top of MARK_BIT (set once the node is replaced).
+ * FROZEN_BIT: the node is waiting to be merged into its successor, and can't
+ * be replaced in the meantime. ABSORB_BIT: set together with MARK_BIT when the
+ * replacement also holds the keys of the frozen predecessor */
+static constexpr uintptr_t FROZEN_BIT = 2;
+static constexpr uintptr_t ABSORB_BIT = 4;
+static constexpr uintptr_t UNROLLED_TAG_MASK =
+    MARK_BIT | FROZEN_BIT | ABSORB_BIT;
+
+template <typename KeyType> struct UnrolledNode {
+  /* a node takes two cache lines: the header, then as many keys as fit */
+  static constexpr int FITTING_KEYS =
+      (2 * CACHE_LINE_SIZE - 2 * sizeof(void *) - sizeof(int)) /
+      sizeof(KeyType);
+  static constexpr int CAPACITY = FITTING_KEYS >= 4 ? FITTING_KEYS : 4;
+
+  /* successor, or replacement once MARK_BIT is set, see the bits above */
+  atomic<UnrolledNode *> next;
+  /* the frozen node whose keys were merged into this one, if it was built by
+   * a merge. Tells the frozen node that it's dead, see was_absorbed() */
+  UnrolledNode *absorbed;
+  int count;
+  /* sorted, and all less than the keys of the successor */
+  KeyType keys[CAPACITY];
+
+  UnrolledNode() : next(nullptr), absorbed(nullptr), count(0) {}
+};
+
+/**
+ * @brief A lock-free sorted linked list of blocks of keys
+ *
+ * @tparam KeyType Type of the keys, must be default constructible and
+ * copyable
+ * @tparam Alloc Node allocator, either HeapAllocator or NodePool
+ */
+template <typename KeyType, template <typename> class Alloc = HeapAllocator>
+class LockFreeUnrolledList {
+private:
+  typedef UnrolledNode<KeyType> Node;
+  typedef Alloc<Node> Allocator;
+  typedef EpochReclaimer<Node, Allocator> Reclaimer;
+
+  static constexpr int CAPACITY = Node::CAPACITY;
+  /* a block left with fewer keys after a remove is merged into the next one */
+  static constexpr int MIN_KEYS = CAPACITY / 4;
+
+  /* sentinel without keys, never replaced or frozen */
+  Node *head;
+  static Reclaimer reclaimer;
+  ShardedCounter key_count;
+
+  static Node *pointer_of(Node *value) {
+    return reinterpret_cast<Node *>(reinterpret_cast<uintptr_t>(value) &
+                                    ~UNROLLED_TAG_MASK);
+  }
+  static uintptr_t tags_of(Node *value) {
+    return reinterpret_cast<uintptr_t>(value) & UNROLLED_TAG_MASK;
+  }
+  static Node *tagged(Node *node, uintptr_t tags) {
+    return reinterpret_cast<Node *>(reinterpret_cast<uintptr_t>(node) | tags);
+  }
+
+  /**
+   * @brief Number of keys of a node less than key, for integral keys. The
+   * block is compared a vector of keys at a time and the matches are summed,
+   * without a branch per key
+   */
+  static int count_less(const Node *node, const KeyType &key) {
+    int count = node->count;
+    int slot = 0;
+    int i = 0;
+#if defined(__GNUC__)
+    typedef KeyType Vector __attribute__((vector_size(16)));
+    typedef decltype(Vector{} < Vector{}) Mask;
+    constexpr int LANES = sizeof(Vector) / sizeof(KeyType);
+    Vector pivot = Vector{} + key;
+    // every lane is -1 for each key less than the pivot
+    Mask less = {};
+    for (; i + LANES <= count; i += LANES) {
+      Vector block;
+      memcpy(&block, node->keys + i, sizeof(block));
+      less += block < pivot;
+    }
+    for (int lane = 0; lane < LANES; ++lane) {
+      slot -= static_cast<int>(less[lane]);
+    }
+#endif
+    for (; i < count; ++i) {
+      slot += node->keys[i] < key;
+    }
+    return slot;
+  }
+
+  /**
+   * @brief Position of the first key of a node that is not less than key
+   */
+  static int find_slot(const Node *node, const KeyType &key) {
+    // the keys are distinct, so as many of them are less than key
+    if constexpr (is_integral_v<KeyType> && !is_same_v<KeyType, bool>) {
+      return count_less(node, key);
+    } else {
+      return static_cast<int>(
+          lower_bound(node->keys, node->keys + node->count, key) -
+          node->keys);
+    }
+  }
+
+  static bool has_key(const Node *node, const KeyType &key) {
+    int slot = find_slot(node, key);
+    return slot < node->count && !(key < node->keys[slot]);
+  }
+
+  /**
+   * @brief Check if a frozen node has been merged into its successor
+   *
+   * @param node Frozen node
+   * @param succ Successor node points to
+   */
+  static bool was_absorbed(Node *node, Node *succ) {
+    if (succ == nullptr) {
+      return false;
+    }
+    Node *value = succ->next.load();
+    return (tags_of(value) & ABSORB_BIT) &&
+           pointer_of(value)->absorbed == node;
+  }
+
+  /**
+   * @brief Check if a node no longer holds the current keys of its block:
+   * either it was replaced, or it was frozen and then merged into its
+   * successor
+   */
+  static bool is_dead(Node *node) {
+    Node *value = node->next.load();
+    if (tags_of(value) & MARK_BIT) {
+      return true;
+    }
+    return (tags_of(value) & FROZEN_BIT) &&
+           was_absorbed(node, pointer_of(value));
+  }
+
+  /**
+   * @brief Get the first node after node that isn't dead, following
+   * replacements
+   */
+  static Node *live_next(Node *node) {
+    Node *succ = pointer_of(node->next.load());
+    while (succ != nullptr && is_dead(succ)) {
+      succ = pointer_of(succ->next.load());
+    }
+    return succ;
+  }
+
+  Node *build_chain(const KeyType *keys, int count, Node *next);
+  void discard_chain(Node *first, Node *next);
+  Node *locate(const KeyType key, Node **pred);
+  void unlink(Node *pred, Node *node);
+  void help_absorb(Node *node);
+
+public:
+  /**
+   * @brief Construct a new Lock Free Unrolled List object
+   */
+  LockFreeUnrolledList() { head = Allocator::new_node(); }
+
+  /**
+   * @brief Destroy the Lock Free Unrolled List object. Unlinked nodes are
+   * already retired, so only the reachable ones are freed here
+   */
+  ~LockFreeUnrolledList() {
+    Node *curr = head;
+    while (curr != nullptr) {
+      Node *next = pointer_of(curr->next.load());
+      Allocator::delete_node(curr);
+      curr = next;
+    }
+  }
+
+  /* the blocks in order, skipping the replaced ones */
+  Node *get_front() { return live_next(head); }
+  Node *get_next(Node *node) { return live_next(node); }
+
+  bool insert(const KeyType key);
+  bool remove(const KeyType key);
+  bool find(const KeyType key) { return contains(key); }
+  bool contains(const KeyType key);
+  void print_list();
+
+  /**
+   * @brief Number of keys in the list, exact when no operation is in progress
+   * @note Counting the keys of the blocks instead would need a snapshot of
+   * the whole list
+   */
+  size_t size() const {
+    long count = key_count.read();
+    return count > 0 ? static_cast<size_t>(count) : 0;
+  }
+
+  /**
+   * @brief Estimate of the number of keys, see ShardedCounter::approximate()
+   */
+  size_t approximate_size() const {
+    long count = key_count.approximate();
+    return count > 0 ? static_cast<size_t>(count) : 0;
+  }
+};
+
+/**
+ * @brief Build the nodes holding a sorted run of keys, split in two halves if
+ * they don't fit in one node
+ *
+ * @param keys Sorted keys, at most 2 * CAPACITY of them
+ * @param count Number of keys
+ * @param next Successor of the last node
+ * @return Node* The first node, or next if there are no keys
+ */
+template <typename KeyType, template <typename> class Alloc>
+typename LockFreeUnrolledList<KeyType, Alloc>::Node *
+LockFreeUnrolledList<KeyType, Alloc>::build_chain(const KeyType *keys,
+                                                  int count, Node *next) {
+  if (count == 0) {
+    return next;
+  }
+  int first_count = count <= CAPACITY ? count : count / 2;
+  Node *first = Allocator::new_node();
+  copy(keys, keys + first_count, first->keys);
+  first->count = first_count;
+  if (first_count == count) {
+    first->next.store(next);
+    return first;
+  }
+  Node *second = Allocator::new_node();
+  copy(keys + first_count, keys + count, second->keys);
+  second->count = count - first_count;
+  second->next.store(next);
+  first->next.store(second);
+  return first;
+}
+
+/**
+ * @brief Free a chain from build_chain() that was never published
+ */
+template <typename KeyType, template <typename> class Alloc>
+void LockFreeUnrolledList<KeyType, Alloc>::discard_chain(Node *first,
+                                                         Node *next) {
+  while (first != next) {
+    Node *succ = first->next.load();
+    Allocator::delete_node(first);
+    first = succ;
+  }
+}
+
+/**
+ * @brief Find the block a key belongs to: the last live node whose first key
+ * is not greater than the key, or the first live node if every key is
+ * greater. Dead nodes on the way are unlinked and retired, like search() in
+ * lock_free_list.h does with marked nodes
+ *
+ * @param key Key to be searched
+ * @param pred Set to the node before the returned one
+ * @note Must be called inside a Reclaimer::Guard
+ * @return Node* The block of the key, nullptr if the list is empty
+ */
+template <typename KeyType, template <typename> class Alloc>
+typename LockFreeUnrolledList<KeyType, Alloc>::Node *
+LockFreeUnrolledList<KeyType, Alloc>::locate(const KeyType key,
+                                             Node **pred) {
+  Node *prev, *curr, *target;
+retry:
+  prev = head;
+  curr = head->next.load();
+  target = nullptr;
+  *pred = head;
+
+  while (curr != nullptr) {
+    Node *value = curr->next.load();
+    if (tags_of(value) & MARK_BIT) {
+      // curr was replaced, link prev straight to what replaced it. prev can
+      // be frozen, but then it must not have been merged into curr
+      Node *prev_value = prev->next.load();
+      if (pointer_of(prev_value) != curr || (tags_of(prev_value) & MARK_BIT) ||
+          ((tags_of(prev_value) & FROZEN_BIT) && was_absorbed(prev, curr))) {
+        goto retry;
+      }
+      Node *succ = pointer_of(value);
+      if (!prev->next.compare_exchange_strong(
+              prev_value, tagged(succ, tags_of(prev_value)))) {
+        goto retry;
+      }
+      reclaimer.retire_node(curr);
+      curr = succ;
+      continue;
+    }
+    if ((tags_of(value) & FROZEN_BIT) &&
+        was_absorbed(curr, pointer_of(value))) {
+      // curr was merged into its successor, mark it so that it's unlinked
+      curr->next.compare_exchange_strong(
+          value, tagged(pointer_of(value), FROZEN_BIT | MARK_BIT));
+      continue;
+    }
+
+    if (target != nullptr && key < curr->keys[0]) {
+      break;
+    }
+    target = curr;
+    *pred = prev;
+    prev = curr;
+    curr = pointer_of(value);
+  }
+  return target;
+}
+
+/**
+ * @brief Unlink a node that was just replaced, if its predecessor still
+ * points to it. Otherwise the next locate() on the way does it
+ *
+ * @param pred Node before node
+ * @param node Replaced node
+ */
+template <typename KeyType, template <typename> class Alloc>
+void LockFreeUnrolledList<KeyType, Alloc>::unlink(Node *pred, Node *node) {
+  Node *pred_value = pred->next.load();
+  if (pointer_of(pred_value) != node || (tags_of(pred_value) & MARK_BIT) ||
+      ((tags_of(pred_value) & FROZEN_BIT) && was_absorbed(pred, node))) {
+    return;
+  }
+  Node *succ = pointer_of(node->next.load());
+  if (pred->next.compare_exchange_strong(pred_value,
+                                         tagged(succ, tags_of(pred_value)))) {
+    reclaimer.retire_node(node);
+  }
+}
+
+/**
+ * @brief Merge a frozen node into its successor
+ *
+ * The node is frozen first (FROZEN_BIT), so its keys can't change anymore.
+ * The merge itself replaces the successor by a node holding the keys of both
+ * (split again if they don't fit), committed by the usual CAS on the
+ * successor's next pointer with ABSORB_BIT added. From then on, the frozen
+ * node is dead and is marked and unlinked like a replaced node. Every step
+ * can be done by any thread that finds the node frozen, so a thread stalling
+ * halfway blocks nobody.
+ *
+ * @param node Frozen node
+ * @note Must be called inside a Reclaimer::Guard
+ */
+template <typename KeyType, template <typename> class Alloc>
+void LockFreeUnrolledList<KeyType, Alloc>::help_absorb(Node *node) {
+  KeyType buffer[2 * CAPACITY];
+  while (true) {
+    Node *value = node->next.load();
+    if ((tags_of(value) & (FROZEN_BIT | MARK_BIT)) != FROZEN_BIT) {
+      return;
+    }
+    Node *succ = pointer_of(value);
+    if (succ == nullptr) {
+      // the successor is gone, there is nothing to merge into
+      node->next.compare_exchange_strong(value, nullptr);
+      return;
+    }
+
+    Node *succ_value = succ->next.load();
+    if (tags_of(succ_value) & MARK_BIT) {
+      if (was_absorbed(node, succ)) {
+        // merged, node is dead now
+        node->next.compare_exchange_strong(
+            value, tagged(succ, FROZEN_BIT | MARK_BIT));
+        return;
+      }
+      // the successor was replaced, skip over it and stay frozen
+      if (node->next.compare_exchange_strong(
+              value, tagged(pointer_of(succ_value), FROZEN_BIT))) {
+        reclaimer.retire_node(succ);
+      }
+      continue;
+    }
+    if (tags_of(succ_value) & FROZEN_BIT) {
+      // the successor is waiting to be merged too, finish that first
+      help_absorb(succ);
+      continue;
+    }
+
+    // keys of node are all less than the keys of succ
+    copy(node->keys, node->keys + node->count, buffer);
+    copy(succ->keys, succ->keys + succ->count, buffer + node->count);
+    Node *merged =
+        build_chain(buffer, node->count + succ->count, succ_value);
+    merged->absorbed = node;
+    Node *expected = succ_value;
+    if (!succ->next.compare_exchange_strong(
+            expected, tagged(merged, MARK_BIT | ABSORB_BIT))) {
+      discard_chain(merged, succ_value);
+    }
+  }
+}
+
+/**
+ * @brief Insert a key into the list sorted by key
+ *
+ * @param key Key to be inserted
+ * @return true If the key is successfully inserted, false otherwise
+ */
+template <typename KeyType, template <typename> class Alloc>
+bool LockFreeUnrolledList<KeyType, Alloc>::insert(const KeyType key) {
+  typename Reclaimer::Guard guard(reclaimer);
+  KeyType buffer[CAPACITY + 1];
+  while (true) {
+    Node *pred;
+    Node *node = locate(key, &pred);
+    if (node == nullptr) {
+      Node *first = build_chain(&key, 1, nullptr);
+      Node *expected = nullptr;
+      if (head->next.compare_exchange_strong(expected, first)) {
+        key_count.add(1);
+        return true;
+      }
+      discard_chain(first, nullptr);
+      continue;
+    }
+
+    Node *value = node->next.load();
+    if (tags_of(value) & MARK_BIT) {
+      continue;
+    }
+    bool frozen = tags_of(value) & FROZEN_BIT;
+    if (frozen && was_absorbed(node, pointer_of(value))) {
+      continue;
+    }
+    int slot = find_slot(node, key);
+    if (slot < node->count && !(key < node->keys[slot])) {
+      return false;
+    }
+    if (frozen) {
+      help_absorb(node);
+      continue;
+    }
+
+    // copy the block with the key added, split in two if it overflows
+    copy(node->keys, node->keys + slot, buffer);
+    buffer[slot] = key;
+    copy(node->keys + slot, node->keys + node->count, buffer + slot + 1);
+    Node *replacement = build_chain(buffer, node->count + 1, value);
+    Node *expected = value;
+    if (node->next.compare_exchange_strong(expected,
+                                           tagged(replacement, MARK_BIT))) {
+      key_count.add(1);
+      unlink(pred, node);
+      return true;
+    }
+    discard_chain(replacement, value);
+  }
+}
+
+/**
+ * @brief Remove a key from the list. A block left empty is unlinked, and a
+ * block left with fewer than MIN_KEYS keys is merged into the next one
+ *
+ * @param key Key to be removed
+ * @return true If the key is successfully removed, false if the key is not
+ * found
+ */
+template <typename KeyType, template <typename> class Alloc>
+bool LockFreeUnrolledList<KeyType, Alloc>::remove(const KeyType key) {
+  typename Reclaimer::Guard guard(reclaimer);
+  KeyType buffer[CAPACITY];
+  while (true) {
+    Node *pred;
+    Node *node = locate(key, &pred);
+    if (node == nullptr) {
+      return false;
+    }
+
+    Node *value = node->next.load();
+    if (tags_of(value) & MARK_BIT) {
+      continue;
+    }
+    bool frozen = tags_of(value) & FROZEN_BIT;
+    if (frozen && was_absorbed(node, pointer_of(value))) {
+      continue;
+    }
+    int slot = find_slot(node, key);
+    if (slot == node->count || key < node->keys[slot]) {
+      return false;
+    }
+    if (frozen) {
+      help_absorb(node);
+      continue;
+    }
+
+    copy(node->keys, node->keys + slot, buffer);
+    copy(node->keys + slot + 1, node->keys + node->count, buffer + slot);
+    int count = node->count - 1;
+    // with no keys left, the node is replaced by its successor
+    Node *replacement = build_chain(buffer, count, value);
+    Node *expected = value;
+    if (!node->next.compare_exchange_strong(expected,
+                                            tagged(replacement, MARK_BIT))) {
+      discard_chain(replacement, value);
+      continue;
+    }
+    key_count.add(-1);
+    unlink(pred, node);
+
+    // freeze the small block and merge it, unless it changed already
+    if (count > 0 && count < MIN_KEYS && value != nullptr) {
+      if (replacement->next.compare_exchange_strong(
+              value, tagged(value, FROZEN_BIT))) {
+        help_absorb(replacement);
+      }
+    }
+    return true;
+  }
+}
+
+/**
+ * @brief Find a key in the list. Only reads the list: dead nodes are stepped
+ * over, not unlinked
+ *
+ * @param key Key to be searched
+ * @return true If the key is found, false otherwise
+ */
+template <typename KeyType, template <typename> class Alloc>
+bool LockFreeUnrolledList<KeyType, Alloc>::contains(const KeyType key) {
+  typename Reclaimer::Guard guard(reclaimer);
+  Node *curr = live_next(head);
+  if (curr == nullptr) {
+    return false;
+  }
+  for (Node *succ = live_next(curr); succ != nullptr && !(key < succ->keys[0]);
+       succ = live_next(succ)) {
+    curr = succ;
+  }
+  return has_key(curr, key);
+}
+
+/**
+ * @brief A helper function to print the list after operations, one block
+ * between brackets per node
+ * @note Not thread-safe
+ */
+template <typename KeyType, template <typename> class Alloc>
+void LockFreeUnrolledList<KeyType, Alloc>::print_list() {
+  for (Node *node = get_front(); node != nullptr; node = get_next(node)) {
+    cout << "[";
+    for (int i = 0; i < node->count; ++i) {
+      cout << (i == 0 ? "" : " ") << node->keys[i];
+    }
+    cout << "] -> ";
+  }
+  cout << "NULL\n";
+}
+
+template <typename KeyType, template <typename> class Alloc>
+typename LockFreeUnrolledList<KeyType, Alloc>::Reclaimer
+    LockFreeUnrolledList<KeyType, Alloc>::reclaimer;
+
+#endif // LOCK_FREE_UNROLLED_LIST_H
@@ -0,0 +1,49 @@
+/**
+ * @file marked_pointer.h
+ * @author Sihan Zhuang (sihanzhu)
+ * @brief Helpers for Harris-style marked pointers. Nodes are always more than
+ * 1 byte aligned, so the lowest bit of a next pointer is free to hold the
+ * logical-delete mark. Keeping the mark inside the pointer means that the mark
+ * and the link are read and changed together by a single load or CAS.
+ * @note The helper names follow the paper: A Pragmatic Implementaion of
+ * Non-Blocking Linked-Lists by Timothy L. Harris.
+ */
+
+#ifndef MARKED_POINTER_H
+#define MARKED_POINTER_H
+
+#include <cstdint>
+
+static constexpr uintptr_t MARK_BIT = 1;
+
+/**
+ * @brief Check if a reference carries the logical-delete mark
+ *
+ * @param ptr Value loaded from a next pointer
+ * @return Whether the mark bit is set
+ */
+template <typename T> inline bool is_marked_reference(T *ptr) {
+  return (reinterpret_cast<uintptr_t>(ptr) & MARK_BIT) != 0;
+}
+
+/**
+ * @brief Get the reference with the mark bit set
+ *
+ * @param ptr Unmarked reference
+ * @return T* Marked reference, must not be dereferenced
+ */
+template <typename T> inline T *get_marked_reference(T *ptr) {
+  return reinterpret_cast<T *>(reinterpret_cast<uintptr_t>(ptr) | MARK_BIT);
+}
+
+/**
+ * @brief Get the reference with the mark bit cleared
+ *
+ * @param ptr Marked or unmarked reference
+ * @return T* Unmarked reference that can be dereferenced
+ */
+template <typename T> inline T *get_unmarked_reference(T *ptr) {
+  return reinterpret_cast<T *>(reinterpret_cast<uintptr_t>(ptr) & ~MARK_BIT);
+}
+
+#endif // MARKED_POINTER_H
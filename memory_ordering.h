@@ -0,0 +1,59 @@
+/**
+ * @file memory_ordering.h
+ * @author Sihan Zhuang (sihanzhu)
+ * @brief This file contains the memory ordering policies of the lock-free
+ * lists, which pick the memory_order of every access to a next pointer.
+ * @note On x86 only the seq_cst stores and CASes cost a fence, so the two
+ * policies perform almost the same. On ARM and POWER every seq_cst load and
+ * store is ordered against all the others, which is a share of the cost of
+ * every hop.
+ */
+
+#ifndef MEMORY_ORDERING_H
+#define MEMORY_ORDERING_H
+
+#include <atomic>
+using namespace std;
+
+/**
+ * @brief Sequentially consistent accesses everywhere, the default of
+ * std::atomic
+ */
+struct SeqCstOrdering {
+  /* load of a next pointer that is followed to the next node */
+  static constexpr memory_order traverse = memory_order_seq_cst;
+  /* load that checks that a node is still linked after a hazard pointer was
+   * published for it */
+  static constexpr memory_order validate = memory_order_seq_cst;
+  /* store to the next pointer of a node that isn't in the list yet */
+  static constexpr memory_order init = memory_order_seq_cst;
+  /* CAS that links, marks or unlinks a node, when it succeeds and fails */
+  static constexpr memory_order publish = memory_order_seq_cst;
+  static constexpr memory_order publish_failure = memory_order_seq_cst;
+};
+
+/**
+ * @brief The weakest orderings the lists are correct with
+ *
+ * A node is written before it's linked, so the CAS linking it releases the
+ * writes and the traversal loads reading the link acquire them. That is all
+ * a list needs when nothing is freed, or with epoch based reclamation, whose
+ * critical sections order themselves.
+ *
+ * Hazard pointers need more: a thread publishes a hazard pointer and then
+ * checks that the node is still linked, while the reclaimer unlinks the node
+ * and then reads the hazard pointers. Each side is a store followed by a
+ * load, which only seq_cst orders. protect() stores and the validate load
+ * are seq_cst, and HazardPointer issues a seq_cst fence before reading the
+ * hazard pointers, so the unlinking CAS itself doesn't have to be.
+ */
+struct AcquireReleaseOrdering {
+  static constexpr memory_order traverse = memory_order_acquire;
+  static constexpr memory_order validate = memory_order_seq_cst;
+  /* published by the CAS that links the node */
+  static constexpr memory_order init = memory_order_relaxed;
+  static constexpr memory_order publish = memory_order_acq_rel;
+  static constexpr memory_order publish_failure = memory_order_acquire;
+};
+
+#endif // MEMORY_ORDERING_H
@@ -0,0 +1,301 @@
+/**
+ * @file node_pool.h
+ * @author Sihan Zhuang (sihanzhu)
+ * @brief This file contains the node allocators the lists can be configured
+ * with. HeapAllocator goes straight to new/delete, NodePool keeps per-thread
+ * free lists carved out of cache-line-aligned slabs.
+ * @note Both allocators provide new_node()/delete_node() for the lists and the
+ * reclamation policies, and the standard allocator interface so that they can
+ * also be used with allocate_shared.
+ */
+
+#ifndef NODE_POOL_H
+#define NODE_POOL_H
+
+#include "sharded_counter.h"
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include <utility>
+using namespace std;
+
+/**
+ * @brief Number of nodes handed out and given back by the allocators, summed
+ * over all node types
+ */
+struct AllocationStats {
+  static ShardedCounter &allocated() {
+    static ShardedCounter counter;
+    return counter;
+  }
+
+  static ShardedCounter &freed() {
+    static ShardedCounter counter;
+    return counter;
+  }
+};
+
+/**
+ * @brief Allocator that uses the global new and delete for every node
+ *
+ * @tparam T Type of the node
+ */
+template <typename T> struct HeapAllocator {
+  typedef T value_type;
+
+  HeapAllocator() {}
+  template <typename U> HeapAllocator(const HeapAllocator<U> &) {}
+
+  template <typename... Args> static T *new_node(Args &&...args) {
+    AllocationStats::allocated().add(1);
+    return new T(std::forward<Args>(args)...);
+  }
+
+  static void delete_node(T *node) {
+    AllocationStats::freed().add(1);
+    delete node;
+  }
+
+  T *allocate(size_t n) {
+    AllocationStats::allocated().add(1);
+    return static_cast<T *>(::operator new(n * sizeof(T)));
+  }
+
+  void deallocate(T *ptr, size_t) {
+    AllocationStats::freed().add(1);
+    ::operator delete(ptr);
+  }
+};
+
+template <typename T, typename U>
+bool operator==(const HeapAllocator<T> &, const HeapAllocator<U> &) {
+  return true;
+}
+
+template <typename T, typename U>
+bool operator!=(const HeapAllocator<T> &, const HeapAllocator<U> &) {
+  return false;
+}
+
+/**
+ * @brief Allocator that hands out nodes from per-thread free lists
+ *
+ * Memory is carved out of cache-line-aligned slabs, so nodes allocated one
+ * after another by a thread are next to each other in memory. Freed nodes go
+ * back to the free list of the thread that frees them. When a thread's free
+ * list grows too long, or the thread exits, its free nodes are handed to a
+ * global depot that other threads refill from, so a thread only takes the
+ * depot mutex once every POOL_BATCH allocations or frees.
+ *
+ * @note Slabs are never returned to the system, freed nodes are only reused by
+ * the same NodePool<T>.
+ * @tparam T Type of the node
+ */
+template <typename T> class NodePool {
+private:
+  struct FreeSlot {
+    FreeSlot *next;
+  };
+
+  static constexpr size_t round_up(size_t size, size_t align) {
+    return (size + align - 1) / align * align;
+  }
+
+  static constexpr size_t SLOT_ALIGN =
+      alignof(T) > alignof(FreeSlot) ? alignof(T) : alignof(FreeSlot);
+  static constexpr size_t SLOT_SIZE = round_up(
+      sizeof(T) > sizeof(FreeSlot) ? sizeof(T) : sizeof(FreeSlot), SLOT_ALIGN);
+  static constexpr size_t SLAB_SIZE = 64 * 1024;
+  static constexpr size_t SLOTS_PER_SLAB = SLAB_SIZE / SLOT_SIZE;
+  /* number of free nodes moved between a thread and the depot at once */
+  static constexpr size_t POOL_BATCH = 256;
+
+  static_assert(SLOT_ALIGN <= CACHE_LINE_SIZE,
+                "NodePool can't align nodes beyond a cache line");
+
+  /**
+   * @brief Free nodes shared by all the threads, protected by a mutex
+   */
+  struct Depot {
+    mutex lock;
+    FreeSlot *free_list = nullptr;
+    size_t count = 0;
+  };
+
+  /**
+   * @brief Free nodes owned by one thread, handed to the depot on exit
+   */
+  struct ThreadCache {
+    FreeSlot *free_list = nullptr;
+    size_t count = 0;
+
+    ThreadCache() { cache_state() = CACHE_ALIVE; }
+    ~ThreadCache() {
+      cache_state() = CACHE_DESTROYED;
+      release(*this, count);
+    }
+  };
+
+  /* the depot is never destroyed, nodes may still be freed by other static
+   * destructors (e.g. the reclamation policies) after it otherwise would be */
+  static Depot &depot() {
+    static Depot *instance = new Depot();
+    return *instance;
+  }
+
+  static ThreadCache &local_cache() {
+    static thread_local ThreadCache cache;
+    return cache;
+  }
+
+  enum CacheState { CACHE_UNUSED, CACHE_ALIVE, CACHE_DESTROYED };
+
+  /* trivially destructible, so it can still be read while the thread's
+   * cache is being destroyed or after it was */
+  static CacheState &cache_state() {
+    static thread_local CacheState state = CACHE_UNUSED;
+    return state;
+  }
+
+  /**
+   * @brief Move up to n free nodes from a thread cache to the depot
+   */
+  static void release(ThreadCache &cache, size_t n) {
+    if (n == 0)
+      return;
+    FreeSlot *first = cache.free_list;
+    FreeSlot *last = first;
+    for (size_t i = 1; i < n; ++i)
+      last = last->next;
+    cache.free_list = last->next;
+    cache.count -= n;
+
+    Depot &d = depot();
+    lock_guard<mutex> guard(d.lock);
+    last->next = d.free_list;
+    d.free_list = first;
+    d.count += n;
+  }
+
+  /**
+   * @brief Refill an empty thread cache from the depot, or from a new slab if
+   * the depot is empty too
+   */
+  static void refill(ThreadCache &cache) {
+    Depot &d = depot();
+    {
+      lock_guard<mutex> guard(d.lock);
+      if (d.free_list != nullptr) {
+        FreeSlot *first = d.free_list;
+        FreeSlot *last = first;
+        size_t n = 1;
+        while (n < POOL_BATCH && last->next != nullptr) {
+          last = last->next;
+          ++n;
+        }
+        d.free_list = last->next;
+        d.count -= n;
+        last->next = cache.free_list;
+        cache.free_list = first;
+        cache.count += n;
+        return;
+      }
+    }
+
+    char *slab = static_cast<char *>(
+        ::operator new(SLAB_SIZE, align_val_t(CACHE_LINE_SIZE)));
+    // link the slots back to front so that they are handed out in address
+    // order
+    for (size_t i = SLOTS_PER_SLAB; i-- > 0;) {
+      FreeSlot *slot = reinterpret_cast<FreeSlot *>(slab + i * SLOT_SIZE);
+      slot->next = cache.free_list;
+      cache.free_list = slot;
+    }
+    cache.count += SLOTS_PER_SLAB;
+  }
+
+public:
+  typedef T value_type;
+
+  NodePool() {}
+  template <typename U> NodePool(const NodePool<U> &) {}
+
+  template <typename... Args> static T *new_node(Args &&...args) {
+    return new (allocate_slot()) T(std::forward<Args>(args)...);
+  }
+
+  static void delete_node(T *node) {
+    node->~T();
+    free_slot(node);
+  }
+
+  /**
+   * @brief Get uninitialized memory for one node
+   *
+   * @return void* Memory of SLOT_SIZE bytes
+   */
+  static void *allocate_slot() {
+    AllocationStats::allocated().add(1);
+    ThreadCache &cache = local_cache();
+    if (cache.free_list == nullptr)
+      refill(cache);
+    FreeSlot *slot = cache.free_list;
+    cache.free_list = slot->next;
+    cache.count--;
+    return slot;
+  }
+
+  /**
+   * @brief Give the memory of one node back to the pool
+   *
+   * @param ptr Memory returned by allocate_slot()
+   */
+  static void free_slot(void *ptr) {
+    AllocationStats::freed().add(1);
+    FreeSlot *slot = static_cast<FreeSlot *>(ptr);
+    if (cache_state() == CACHE_DESTROYED) {
+      // the thread is exiting, go straight to the depot
+      Depot &d = depot();
+      lock_guard<mutex> guard(d.lock);
+      slot->next = d.free_list;
+      d.free_list = slot;
+      d.count++;
+      return;
+    }
+    ThreadCache &cache = local_cache();
+    slot->next = cache.free_list;
+    cache.free_list = slot;
+    cache.count++;
+    if (cache.count >= 2 * POOL_BATCH)
+      release(cache, POOL_BATCH);
+  }
+
+  T *allocate(size_t n) {
+    if (n != 1) {
+      AllocationStats::allocated().add(1);
+      return static_cast<T *>(::operator new(n * sizeof(T)));
+    }
+    return static_cast<T *>(allocate_slot());
+  }
+
+  void deallocate(T *ptr, size_t n) {
+    if (n != 1) {
+      AllocationStats::freed().add(1);
+      ::operator delete(ptr);
+      return;
+    }
+    free_slot(ptr);
+  }
+};
+
+template <typename T, typename U>
+bool operator==(const NodePool<T> &, const NodePool<U> &) {
+  return true;
+}
+
+template <typename T, typename U>
+bool operator!=(const NodePool<T> &, const NodePool<U> &) {
+  return false;
+}
+
+#endif // NODE_POOL_H
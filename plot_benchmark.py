@@ -1,40 +1,26 @@
 import pandas as pd
 import matplotlib.pyplot as plt
 
-df = pd.read_csv("benchmark_results.txt", names=["test_type", "threads", "time"])
+# each line is <structure>_<workload>,<threads>,<ops per second>
+df = pd.read_csv("benchmark_results.txt", names=["test_type", "threads", "throughput"])
 df["threads"] = pd.to_numeric(df["threads"], errors="coerce")
-df["time"] = pd.to_numeric(df["time"], errors="coerce")
+df["throughput"] = pd.to_numeric(df["throughput"], errors="coerce")
+df["workload"] = df["test_type"].str.split("_", n=1).str[1]
 # df = df.dropna()
 
-insert_data = df[df["test_type"].str.contains("insert")]
-mixed_data = df[df["test_type"].str.contains("mixed")]
+for workload in df["workload"].unique():
+    workload_data = df[df["workload"] == workload]
+    plt.figure(figsize=(10, 6))
+    for test_type in workload_data["test_type"].unique():
+        subset = workload_data[workload_data["test_type"] == test_type]
+        plt.plot(subset["threads"].values, subset["throughput"].values,
+                 label=test_type.split("_")[0])
 
-# insert-only
-plt.figure(figsize=(10, 6))
-for test_type in insert_data["test_type"].unique():
-    subset = insert_data[insert_data["test_type"] == test_type]
-    plt.plot(subset["threads"].values, subset["time"].values, label=test_type)
-
-plt.title("Insert-only Benchmark")
-plt.xlabel("Threads")
-plt.ylabel("Time (ms)")
-plt.xscale("log", base=2)
-plt.legend()
-plt.grid(True)
-plt.savefig("insert_only_benchmark.png")
-plt.show()
-
-# mixed
-plt.figure(figsize=(10, 6))
-for test_type in mixed_data["test_type"].unique():
-    subset = mixed_data[mixed_data["test_type"] == test_type]
-    plt.plot(subset["threads"].values, subset["time"].values, label=test_type)
-
-plt.title("Mixed Benchmark")
-plt.xlabel("Threads")
-plt.ylabel("Time (ms)")
-plt.xscale("log", base=2)
-plt.legend()
-plt.grid(True)
-plt.savefig("mixed_benchmark.png")
-plt.show()
+    plt.title("Throughput, workload " + workload)
+    plt.xlabel("Threads")
+    plt.ylabel("Throughput (ops/s)")
+    plt.xscale("log", base=2)
+    plt.legend()
+    plt.grid(True)
+    plt.savefig("benchmark_" + workload + ".png")
+    plt.show()
@@ -0,0 +1,54 @@
+/**
+ * @file sentinel_keys.h
+ * @author Sihan Zhuang (sihanzhu)
+ * @brief This file contains the keys stored in the head and tail sentinels of
+ * the lock-free lists. For arithmetic keys, the head holds the smallest value
+ * of the type and the tail the largest, so that no key is less than the
+ * tail's. A traversal can then stop on a single key comparison, instead of
+ * also checking whether it reached the tail on every hop.
+ * @note The tail's key can still be a real key. The lists keep checking for
+ * the tail once the traversal stops, so a node holding the largest value is
+ * found before the tail and never mistaken for it.
+ */
+
+#ifndef SENTINEL_KEYS_H
+#define SENTINEL_KEYS_H
+
+#include <limits>
+#include <type_traits>
+using namespace std;
+
+/**
+ * @brief Keys of the sentinels of a list of keys of type KeyType. Other types
+ * get default-constructed keys, and the lists compare against the tail
+ * pointer instead
+ */
+template <typename KeyType, typename = void> struct SentinelKeys {
+  /* whether no key compares greater than tail_key() */
+  static constexpr bool bounded = false;
+
+  static KeyType head_key() { return KeyType{}; }
+  static KeyType tail_key() { return KeyType{}; }
+};
+
+template <typename KeyType>
+struct SentinelKeys<KeyType, enable_if_t<is_arithmetic_v<KeyType>>> {
+  static constexpr bool bounded = true;
+
+  static constexpr KeyType head_key() {
+    if constexpr (numeric_limits<KeyType>::has_infinity) {
+      return -numeric_limits<KeyType>::infinity();
+    } else {
+      return numeric_limits<KeyType>::lowest();
+    }
+  }
+  static constexpr KeyType tail_key() {
+    if constexpr (numeric_limits<KeyType>::has_infinity) {
+      return numeric_limits<KeyType>::infinity();
+    } else {
+      return numeric_limits<KeyType>::max();
+    }
+  }
+};
+
+#endif // SENTINEL_KEYS_H
@@ -0,0 +1,98 @@
+/**
+ * @file sharded_counter.h
+ * @author Sihan Zhuang (sihanzhu)
+ * @brief This file contains a counter that is split into per-thread shards,
+ * each on its own cache line, so that threads counting at the same time don't
+ * contend on a single atomic.
+ */
+
+#ifndef SHARDED_COUNTER_H
+#define SHARDED_COUNTER_H
+
+#include <array>
+#include <atomic>
+using namespace std;
+
+static constexpr size_t CACHE_LINE_SIZE = 64;
+static constexpr int COUNTER_SHARDS = 256;
+
+/**
+ * @brief Get the shard index of the calling thread. Threads are numbered in
+ * the order they first ask, so up to COUNTER_SHARDS threads each get a shard
+ * of their own
+ *
+ * @return int Shard index of the calling thread
+ */
+inline int thread_slot() {
+  static atomic<int> next_slot{0};
+  static thread_local int slot = next_slot.fetch_add(1) % COUNTER_SHARDS;
+  return slot;
+}
+
+/**
+ * @brief A counter split into per-thread shards
+ *
+ * Besides the exact sum of the shards, the counter keeps an approximate total
+ * that can be read with a single load. Each shard only reports to it when its
+ * value crosses a multiple of APPROXIMATE_STEP, so the total is updated once
+ * every APPROXIMATE_STEP additions of one thread at most, and is off by less
+ * than APPROXIMATE_STEP per shard in use.
+ */
+class ShardedCounter {
+public:
+  static constexpr long APPROXIMATE_STEP = 64;
+
+private:
+  struct alignas(CACHE_LINE_SIZE) Shard {
+    atomic<long> value{0};
+  };
+
+  array<Shard, COUNTER_SHARDS> shards;
+  /* sum of the shard values rounded down to a multiple of APPROXIMATE_STEP */
+  alignas(CACHE_LINE_SIZE) atomic<long> approximate_total{0};
+
+  static long round_down(long value) {
+    long steps = value / APPROXIMATE_STEP;
+    if (value % APPROXIMATE_STEP < 0) {
+      steps--;
+    }
+    return steps * APPROXIMATE_STEP;
+  }
+
+public:
+  /**
+   * @brief Add to the calling thread's shard
+   *
+   * @param n Amount to add, may be negative
+   */
+  void add(long n) {
+    long old = shards[thread_slot()].value.fetch_add(n, memory_order_relaxed);
+    long change = round_down(old + n) - round_down(old);
+    if (change != 0) {
+      approximate_total.fetch_add(change, memory_order_relaxed);
+    }
+  }
+
+  /**
+   * @brief Sum all the shards
+   * @note Only exact if no thread is counting at the same time
+   * @return long The total
+   */
+  long read() const {
+    long total = 0;
+    for (const auto &shard : shards)
+      total += shard.value.load(memory_order_relaxed);
+    return total;
+  }
+
+  /**
+   * @brief Read the approximate total, in constant time
+   * @return long The total, off by less than APPROXIMATE_STEP for every
+   * thread that counted
+   */
+  long approximate() const {
+    return approximate_total.load(memory_order_relaxed);
+  }
+};
+
+#endif // SHARDED_COUNTER_H
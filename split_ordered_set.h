@@ -0,0 +1,238 @@
+/**
+ * @file split_ordered_set.h
+ * @author Sihan Zhuang (sihanzhu)
+ * @brief This file contains a lock-free hash set built on top of a single
+ * LockFreeList, using the split-ordered lists of Shalev and Shavit.
+ * @note All the keys live in one list, sorted by the bit-reversed hash
+ * (the split order). Bucket b starts at a sentinel node whose split-order key
+ * is the reversed b, so the keys of bucket b sit between its sentinel and the
+ * next one. Doubling the number of buckets only adds sentinels, the nodes
+ * themselves never move.
+ */
+
+#ifndef SPLIT_ORDERED_SET_H
+#define SPLIT_ORDERED_SET_H
+
+#include "lock_free_list.h"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+using namespace std;
+
+/**
+ * @brief Key of the underlying list. Regular keys have the lowest bit of
+ * so_key set and sentinels have it cleared, so they never compare equal
+ *
+ * @tparam KeyType Type of the keys of the set
+ */
+template <typename KeyType> struct SplitOrderKey {
+  uint64_t so_key;
+  KeyType key;
+
+  bool operator<(const SplitOrderKey &other) const {
+    if (so_key != other.so_key)
+      return so_key < other.so_key;
+    // different keys with the same hash are kept sorted by key
+    return key < other.key;
+  }
+  bool operator==(const SplitOrderKey &other) const {
+    return so_key == other.so_key && key == other.key;
+  }
+  bool operator!=(const SplitOrderKey &other) const {
+    return !(*this == other);
+  }
+};
+
+/**
+ * @brief Reverse the order of the bits of a 64-bit word
+ *
+ * @param x Word to be reversed
+ * @return uint64_t The reversed word
+ */
+inline uint64_t reverse_bits(uint64_t x) {
+  x = ((x >> 1) & 0x5555555555555555ULL) | ((x & 0x5555555555555555ULL) << 1);
+  x = ((x >> 2) & 0x3333333333333333ULL) | ((x & 0x3333333333333333ULL) << 2);
+  x = ((x >> 4) & 0x0F0F0F0F0F0F0F0FULL) | ((x & 0x0F0F0F0F0F0F0F0FULL) << 4);
+  x = ((x >> 8) & 0x00FF00FF00FF00FFULL) | ((x & 0x00FF00FF00FF00FFULL) << 8);
+  x = ((x >> 16) & 0x0000FFFF0000FFFFULL) |
+      ((x & 0x0000FFFF0000FFFFULL) << 16);
+  return (x >> 32) | (x << 32);
+}
+
+/**
+ * @brief A lock-free hash set
+ *
+ * @tparam KeyType Type of the keys, must be hashable with std::hash and
+ * ordered with operator<
+ * @tparam Reclaim Memory reclamation policy of the underlying list
+ * @tparam Alloc Node allocator of the underlying list
+ */
+template <typename KeyType,
+          template <typename, typename> class Reclaim = HazardPointer,
+          template <typename> class Alloc = HeapAllocator>
+class SplitOrderedSet {
+private:
+  typedef SplitOrderKey<KeyType> ListKey;
+  typedef LockFreeNode<ListKey> Node;
+
+  static constexpr uint64_t HIGH_BIT = 1ULL << 63;
+  /* segment s holds 2^s buckets (2 for segment 0), 63 segments cover every
+   * bucket index a hash without its top bit can map to */
+  static constexpr int NUM_SEGMENTS = 63;
+  static constexpr size_t INITIAL_BUCKETS = 2;
+  /* average number of keys per bucket before the bucket count is doubled */
+  static constexpr size_t MAX_LOAD = 2;
+
+  LockFreeList<ListKey, Reclaim, Alloc> list;
+  /* bucket sentinels, allocated one segment at a time on first use */
+  atomic<atomic<Node *> *> segments[NUM_SEGMENTS];
+  atomic<size_t> bucket_count{INITIAL_BUCKETS};
+
+  static uint64_t hash_key(const KeyType &key) {
+    return static_cast<uint64_t>(hash<KeyType>()(key)) & ~HIGH_BIT;
+  }
+
+  static ListKey regular_key(const KeyType &key) {
+    return ListKey{reverse_bits(hash_key(key) | HIGH_BIT), key};
+  }
+
+  static ListKey sentinel_key(size_t bucket) {
+    return ListKey{reverse_bits(bucket), KeyType{}};
+  }
+
+  /**
+   * @brief Get the slot holding the sentinel of a bucket, allocating its
+   * segment if needed
+   *
+   * @param bucket Bucket index
+   * @return atomic<Node *>& The slot, nullptr until the bucket is initialized
+   */
+  atomic<Node *> &bucket_slot(size_t bucket) {
+    int segment = 0;
+    size_t first = 0;
+    if (bucket >= INITIAL_BUCKETS) {
+      segment = 63 - __builtin_clzll(bucket);
+      first = size_t(1) << segment;
+    }
+    atomic<Node *> *buckets = segments[segment].load();
+    if (buckets == nullptr) {
+      size_t size = segment == 0 ? INITIAL_BUCKETS : first;
+      atomic<Node *> *fresh = new atomic<Node *>[size];
+      for (size_t i = 0; i < size; ++i)
+        fresh[i].store(nullptr);
+      if (segments[segment].compare_exchange_strong(buckets, fresh)) {
+        buckets = fresh;
+      } else {
+        delete[] fresh;
+      }
+    }
+    return buckets[bucket - first];
+  }
+
+  /**
+   * @brief Get the sentinel of a bucket. A new bucket is split from its
+   * parent, the bucket with the same index minus its highest set bit
+   *
+   * @param bucket Bucket index
+   * @return Node* The sentinel of the bucket
+   */
+  Node *get_bucket(size_t bucket) {
+    atomic<Node *> &slot = bucket_slot(bucket);
+    Node *sentinel = slot.load();
+    if (sentinel != nullptr) {
+      return sentinel;
+    }
+    size_t parent = bucket & ~(size_t(1) << (63 - __builtin_clzll(bucket)));
+    // every thread initializing the bucket gets the same node back
+    sentinel = list.insert_sentinel(get_bucket(parent), sentinel_key(bucket));
+    slot.store(sentinel);
+    return sentinel;
+  }
+
+  Node *bucket_of(const KeyType &key) {
+    return get_bucket(hash_key(key) & (bucket_count.load() - 1));
+  }
+
+public:
+  /**
+   * @brief Construct a new Split Ordered Set object. The head of the list is
+   * the sentinel of bucket 0
+   */
+  SplitOrderedSet() {
+    for (auto &segment : segments)
+      segment.store(nullptr);
+    bucket_slot(0).store(list.get_head());
+  }
+
+  /**
+   * @brief Destroy the Split Ordered Set object. The nodes, sentinels
+   * included, are owned by the list
+   */
+  ~SplitOrderedSet() {
+    for (auto &segment : segments)
+      delete[] segment.load();
+  }
+
+  size_t get_bucket_count() { return bucket_count.load(); }
+  /* contention counters of the underlying list, see list_stats.h */
+  ListStats stats() const { return list.stats(); }
+  /* the list counts regular keys only, not the bucket sentinels */
+  size_t size() const { return list.size(); }
+  size_t approximate_size() const { return list.approximate_size(); }
+
+  bool insert(const KeyType key);
+  bool remove(const KeyType key);
+  bool find(const KeyType key);
+};
+
+/**
+ * @brief Insert a key into the set, growing the bucket array if the load
+ * factor gets too high
+ *
+ * @param key Key to be inserted
+ * @return true If the key is successfully inserted, false otherwise
+ */
+template <typename KeyType, template <typename, typename> class Reclaim,
+          template <typename> class Alloc>
+bool SplitOrderedSet<KeyType, Reclaim, Alloc>::insert(const KeyType key) {
+  if (!list.insert_from(bucket_of(key), regular_key(key))) {
+    return false;
+  }
+
+  // the approximate count is a single load, so it's checked on every insert.
+  // It lags behind by a few keys per thread, which only delays the growth
+  size_t buckets = bucket_count.load();
+  if (list.approximate_size() / buckets > MAX_LOAD &&
+      buckets < (size_t(1) << NUM_SEGMENTS)) {
+    // the new buckets are initialized lazily by the first thread using them
+    bucket_count.compare_exchange_strong(buckets, 2 * buckets);
+  }
+  return true;
+}
+
+/**
+ * @brief Remove a key from the set
+ *
+ * @param key Key to be removed
+ * @return true If the key is successfully removed, false if the key is not
+ * found
+ */
+template <typename KeyType, template <typename, typename> class Reclaim,
+          template <typename> class Alloc>
+bool SplitOrderedSet<KeyType, Reclaim, Alloc>::remove(const KeyType key) {
+  return list.remove_from(bucket_of(key), regular_key(key));
+}
+
+/**
+ * @brief Find a key in the set
+ *
+ * @param key Key to be searched
+ * @return true If the key is found, false otherwise
+ */
+template <typename KeyType, template <typename, typename> class Reclaim,
+          template <typename> class Alloc>
+bool SplitOrderedSet<KeyType, Reclaim, Alloc>::find(const KeyType key) {
+  return list.find_from(bucket_of(key), regular_key(key));
+}
+
+#endif // SPLIT_ORDERED_SET_H
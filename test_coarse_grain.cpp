@@ -272,6 +272,181 @@ int test_mixed() {
   return ret;
 }
 
+/**
+ * @brief Test that batches skip the keys that are already there (or already
+ * gone) and apply the rest
+ *
+ * @return int 0 if the test passes, -1 otherwise
+ */
+int test_batch() {
+  int ret = 0;
+  CoarseGrainList<int> list;
+  vector<int> evens = {0, 2, 4, 6, 8};
+  vector<int> all = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+
+  if (list.insert_batch(evens.begin(), evens.end()) != evens.size()) {
+    cout << "Failed to insert the even keys\n";
+    ret = -1;
+  }
+  if (list.insert_batch(all.begin(), all.end()) != all.size() - evens.size()) {
+    cout << "Should only insert the odd keys\n";
+    ret = -1;
+  }
+  if (list.remove_batch(evens.begin(), evens.end()) != evens.size()) {
+    cout << "Failed to remove the even keys\n";
+    ret = -1;
+  }
+  if (list.remove_batch(all.begin(), all.end()) != all.size() - evens.size()) {
+    cout << "Should only remove the odd keys\n";
+    ret = -1;
+  }
+  if (list.get_front() != list.get_tail()) {
+    cout << "List is not empty after removing every key\n";
+    ret = -1;
+  }
+
+  // unsorted batches restart from the head instead of skipping keys
+  vector<int> unsorted = {5, 1, 9, 3, 7, 3};
+  vector<int> removed = {9, 1, 7, 1};
+  if (list.insert_batch(unsorted.begin(), unsorted.end()) != 5 ||
+      list.remove_batch(removed.begin(), removed.end()) != 3) {
+    cout << "Unsorted batches didn't apply every key once\n";
+    ret = -1;
+  }
+  vector<int> keys;
+  list.range_query(0, 10, keys);
+  if (keys != vector<int>({3, 5}) || !list.find(3) || !list.find(5)) {
+    cout << "List should contain 3, 5 after the unsorted batches\n";
+    ret = -1;
+  }
+  return ret;
+}
+
+/**
+ * @brief Test that range queries return the keys in [lo, hi] in order
+ *
+ * @return int 0 if the test passes, -1 otherwise
+ */
+int test_range_query() {
+  CoarseGrainList<int> list;
+  for (int i = 0; i < 20; i += 2) {
+    list.insert(i);
+  }
+
+  vector<int> keys;
+  if (list.range_query(3, 12, keys) != 5 ||
+      keys != vector<int>({4, 6, 8, 10, 12})) {
+    cout << "Wrong keys in [3, 12]\n";
+    return -1;
+  }
+  int visited = 0;
+  list.for_each_in_range(100, 200, [&visited](const int &) { visited++; });
+  if (visited != 0) {
+    cout << "Visited keys outside of the list\n";
+    return -1;
+  }
+  return 0;
+}
+
+/**
+ * @brief Worker function that looks up the even keys while the odd keys churn
+ *
+ * @param list CoarseGrainList object
+ * @param failures Incremented when an even key is missing
+ */
+void even_reader_worker(CoarseGrainList<int, NodePool> &list,
+                        atomic<int> &failures) {
+  for (int round = 0; round < 20; ++round) {
+    for (int i = 0; i < NUM_OPERATIONS; i += 2) {
+      if (!list.find(i))
+        failures++;
+    }
+  }
+}
+
+/**
+ * @brief Test lookups sharing the lock while a writer inserts and removes,
+ * then that a list too long to be freed recursively is destroyed
+ *
+ * @return int 0 if the test passes, -1 otherwise
+ */
+int test_shared_readers() {
+  CoarseGrainList<int, NodePool> list;
+  for (int i = 0; i < NUM_OPERATIONS; i += 2) {
+    list.insert(i);
+  }
+  atomic<int> failures{0};
+
+  vector<thread> readers;
+  for (int i = 0; i < 4; ++i) {
+    readers.push_back(thread(even_reader_worker, ref(list), ref(failures)));
+  }
+  for (int round = 0; round < 20; ++round) {
+    for (int i = 1; i < NUM_OPERATIONS; i += 2) {
+      list.insert(i);
+    }
+    for (int i = 1; i < NUM_OPERATIONS; i += 2) {
+      list.remove(i);
+    }
+  }
+  for (auto &t : readers) {
+    t.join();
+  }
+  if (failures != 0) {
+    cout << failures << " lookups missed an even key\n";
+    return -1;
+  }
+
+  vector<int> keys;
+  for (int i = 0; i < 1000000; ++i) {
+    keys.push_back(i);
+  }
+  CoarseGrainList<int> *long_list = new CoarseGrainList<int>();
+  long_list->insert_batch(keys.begin(), keys.end());
+  delete long_list;
+  return 0;
+}
+
+/**
+ * @brief Test lookups and updates starting from the fingers, while the writer
+ * keeps freeing the nodes the readers' fingers may point to
+ *
+ * @return int 0 if the test passes, -1 otherwise
+ */
+int test_finger() {
+  CoarseGrainList<int, NodePool> list;
+  list.enable_finger(true);
+  for (int i = 0; i < NUM_OPERATIONS; i += 2) {
+    list.insert(i);
+  }
+  atomic<int> failures{0};
+
+  vector<thread> readers;
+  for (int i = 0; i < 4; ++i) {
+    readers.push_back(thread(even_reader_worker, ref(list), ref(failures)));
+  }
+  for (int round = 0; round < 20; ++round) {
+    for (int i = 1; i < NUM_OPERATIONS; i += 2) {
+      list.insert(i);
+      list.remove(i - 2);
+    }
+    list.remove(NUM_OPERATIONS - 1);
+  }
+  for (auto &t : readers) {
+    t.join();
+  }
+  if (failures != 0) {
+    cout << failures << " lookups missed an even key\n";
+    return -1;
+  }
+  if (list.size() != NUM_OPERATIONS / 2) {
+    cout << "List has " << list.size() << " keys instead of "
+         << NUM_OPERATIONS / 2 << "\n";
+    return -1;
+  }
+  return 0;
+}
+
 /**
  * @brief Entry point. Run the tests and print the results.
  *
@@ -300,6 +475,46 @@ int main() {
     cout << "Mixed test passed\n";
   }
 
+  cout << "======================= Testing batch operations "
+          "=======================\n";
+  if (test_batch() != 0) {
+    cout << "Test batch operations failed\n";
+    success = false;
+  }
+  if (success) {
+    cout << "Batch test passed\n";
+  }
+
+  cout << "======================= Testing range queries "
+          "=======================\n";
+  if (test_range_query() != 0) {
+    cout << "Test range queries failed\n";
+    success = false;
+  }
+  if (success) {
+    cout << "Range query test passed\n";
+  }
+
+  cout << "======================= Testing shared readers "
+          "=======================\n";
+  if (test_shared_readers() != 0) {
+    cout << "Test shared readers failed\n";
+    success = false;
+  }
+  if (success) {
+    cout << "Shared readers test passed\n";
+  }
+
+  cout << "======================= Testing search fingers "
+          "=======================\n";
+  if (test_finger() != 0) {
+    cout << "Test search fingers failed\n";
+    success = false;
+  }
+  if (success) {
+    cout << "Search finger test passed\n";
+  }
+
   if (success) {
     cout << "All tests passed\n";
   }
@@ -0,0 +1,278 @@
+#include "flat_combining_list.h"
+#include "key_distribution.h"
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Number of operations to be performed by each worker
+ */
+const int NUM_OPERATIONS = 1000;
+
+/**
+ * @brief A simpler test case for the list where operations are done
+ * sequentially, so that every request is combined by its own thread
+ *
+ * @return int 0 if the test passes, -1 otherwise
+ */
+int test_sequential() {
+  int ret = 0;
+  FlatCombiningList<int> list;
+
+  list.insert(10);
+  list.insert(20);
+  list.insert(15);
+  if (list.insert(20)) {
+    cout << "Inserted 20 twice\n";
+    ret = -1;
+  }
+  if (!list.remove(15) || list.remove(15)) {
+    cout << "Removing 15 should only succeed once\n";
+    ret = -1;
+  }
+  list.insert(25);
+  list.insert(5);
+  list.remove(10);
+
+  list.print_list();
+  vector<int> keys;
+  list.range_query(0, 100, keys);
+  if (keys != vector<int>({5, 20, 25}) || list.size() != 3) {
+    cout << "List should contain 5, 20, 25\n";
+    ret = -1;
+  }
+  if (!list.find(20) || list.find(10)) {
+    cout << "Lookups don't match the list\n";
+    ret = -1;
+  }
+  return ret;
+}
+
+/**
+ * @brief Worker function to insert elements into the list
+ *
+ * @param list FlatCombiningList object
+ * @param start Start index for the worker
+ * @param end End index for the worker
+ */
+void insert_worker(FlatCombiningList<int> &list, int start, int end) {
+  for (int i = start; i < end; ++i) {
+    list.insert(i);
+  }
+}
+
+/**
+ * @brief Worker function to remove the even elements of its range
+ *
+ * @param list FlatCombiningList object
+ * @param start Start index for the worker, even
+ * @param end End index for the worker
+ * @param failures Incremented when a key that was inserted isn't removed
+ */
+void remove_even_worker(FlatCombiningList<int> &list, int start, int end,
+                        atomic<int> &failures) {
+  for (int i = start; i < end; i += 2) {
+    if (!list.remove(i))
+      failures++;
+  }
+}
+
+/**
+ * @brief Worker function that looks up the odd keys, which stay in the list
+ *
+ * @param list FlatCombiningList object
+ * @param num_keys Number of keys inserted
+ * @param failures Incremented when an odd key is missing
+ */
+void odd_reader_worker(FlatCombiningList<int> &list, int num_keys,
+                       atomic<int> &failures) {
+  for (int i = 1; i < num_keys; i += 2) {
+    if (!list.find(i))
+      failures++;
+  }
+}
+
+/**
+ * @brief Test concurrent inserts of disjoint ranges, then concurrent removes
+ * of the even keys while other threads look up the odd ones
+ *
+ * @return int 0 if the test passes, -1 otherwise
+ */
+int test_concurrent() {
+  FlatCombiningList<int> list;
+  int num_threads = 16;
+  int num_keys = num_threads * NUM_OPERATIONS;
+
+  vector<thread> threads;
+  for (int i = 0; i < num_threads; ++i) {
+    threads.push_back(thread(insert_worker, ref(list), i * NUM_OPERATIONS,
+                             (i + 1) * NUM_OPERATIONS));
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+  vector<int> keys;
+  list.range_query(0, num_keys, keys);
+  if (list.size() != static_cast<size_t>(num_keys) ||
+      keys.size() != static_cast<size_t>(num_keys)) {
+    cout << "List has " << list.size() << " keys instead of " << num_keys
+         << "\n";
+    return -1;
+  }
+  for (int i = 0; i < num_keys; ++i) {
+    if (keys[i] != i) {
+      cout << "Expected " << i << " but got " << keys[i] << "\n";
+      return -1;
+    }
+  }
+
+  atomic<int> failures{0};
+  threads.clear();
+  for (int i = 0; i < num_threads; ++i) {
+    threads.push_back(thread(remove_even_worker, ref(list), i * NUM_OPERATIONS,
+                             (i + 1) * NUM_OPERATIONS, ref(failures)));
+  }
+  for (int i = 0; i < 4; ++i) {
+    threads.push_back(
+        thread(odd_reader_worker, ref(list), num_keys, ref(failures)));
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+  if (failures != 0) {
+    cout << failures << " removes or lookups failed\n";
+    return -1;
+  }
+  keys.clear();
+  list.range_query(0, num_keys, keys);
+  if (list.size() != static_cast<size_t>(num_keys / 2) ||
+      keys.size() != static_cast<size_t>(num_keys / 2)) {
+    cout << "List has " << list.size() << " keys instead of " << num_keys / 2
+         << "\n";
+    return -1;
+  }
+  for (size_t i = 0; i < keys.size(); ++i) {
+    if (keys[i] % 2 != 1) {
+      cout << "Even key " << keys[i] << " is still in the list\n";
+      return -1;
+    }
+  }
+  return 0;
+}
+
+/**
+ * @brief Number of keys the threads of the contention test fight over
+ */
+const int HOT_KEYS = 16;
+
+/**
+ * @brief Worker function that inserts and removes a few hot keys, and counts
+ * how many times its inserts and removes of each key succeeded
+ *
+ * @param list FlatCombiningList object
+ * @param seed Random seed of the worker
+ * @param net Inserts minus removes that succeeded, per key
+ */
+void hot_key_worker(FlatCombiningList<int, NodePool> &list, int seed,
+                    vector<long> &net) {
+  FastRandom rng(seed);
+  for (int i = 0; i < 20 * NUM_OPERATIONS; ++i) {
+    int key = static_cast<int>(rng.next() % HOT_KEYS);
+    switch (rng.next() % 3) {
+    case 0:
+      net[key] += list.insert(key);
+      break;
+    case 1:
+      net[key] -= list.remove(key);
+      break;
+    default:
+      list.find(key);
+    }
+  }
+}
+
+/**
+ * @brief Test that the results of the combined requests are consistent: for
+ * every key, the inserts that succeeded minus the removes that succeeded is 1
+ * if the key ends up in the list and 0 otherwise
+ *
+ * @return int 0 if the test passes, -1 otherwise
+ */
+int test_hot_keys() {
+  FlatCombiningList<int, NodePool> list;
+  int num_threads = 8;
+  vector<vector<long>> net(num_threads, vector<long>(HOT_KEYS, 0));
+
+  vector<thread> threads;
+  for (int i = 0; i < num_threads; ++i) {
+    threads.push_back(thread(hot_key_worker, ref(list), i + 1, ref(net[i])));
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+
+  size_t present = 0;
+  for (int key = 0; key < HOT_KEYS; ++key) {
+    long total = 0;
+    for (int i = 0; i < num_threads; ++i) {
+      total += net[i][key];
+    }
+    bool found = list.find(key);
+    present += found;
+    if (total != (found ? 1 : 0)) {
+      cout << "Key " << key << " was inserted " << total
+           << " more times than removed, but is "
+           << (found ? "in" : "not in") << " the list\n";
+      return -1;
+    }
+  }
+  if (list.size() != present) {
+    cout << "List has " << list.size() << " keys instead of " << present
+         << "\n";
+    return -1;
+  }
+  return 0;
+}
+
+/**
+ * @brief Entry point. Run the tests and print the results.
+ *
+ * @return int 0 if program finishes
+ */
+int main() {
+  bool success = true;
+
+  cout << "======================= Testing sequential operations "
+          "=======================\n";
+  if (test_sequential() != 0) {
+    cout << "Test sequential failed\n";
+    success = false;
+  }
+  if (success) {
+    cout << "Sequential test passed\n";
+  }
+
+  cout << "======================= Testing concurrent operations "
+          "=======================\n";
+  if (test_concurrent() != 0) {
+    cout << "Test concurrent failed\n";
+    success = false;
+  }
+  if (success) {
+    cout << "Concurrent test passed\n";
+  }
+
+  cout << "======================= Testing hot keys "
+          "=======================\n";
+  if (test_hot_keys() != 0) {
+    cout << "Test hot keys failed\n";
+    success = false;
+  }
+  if (success) {
+    cout << "Hot key test passed\n";
+  }
+
+  if (success) {
+    cout << "All tests passed\n";
+  }
+  return 0;
+}
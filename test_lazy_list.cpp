@@ -0,0 +1,502 @@
+#include "key_distribution.h"
+#include "lazy_list.h"
+#include <thread>
+#include <vector>
+
+/**
+ * @brief A simpler test case for the list where operations are done
+ * sequentially
+ *
+ * This test is just to make sure that the code can run and operations can be
+ * performed in a simple setting. After all the operations, the list should
+ * contain 5, 20, 25.
+ *
+ * @return int 0 if the test passes, -1 otherwise
+ */
+int test_sequential() {
+  int ret = 0;
+  LazyList<int> list;
+
+  list.insert(10);
+  list.insert(20);
+  list.insert(15);
+
+  list.remove(15);
+
+  list.insert(25);
+  list.insert(5);
+
+  list.remove(10);
+
+  list.print_list();
+  // list should contain 5, 20, 25
+  LazyNode<int> *curr = list.get_front();
+  if (curr->key != 5) {
+    cout << "First element is " << curr->key << " while it should be 5\n";
+    ret = -1;
+  }
+  curr = list.get_next(curr);
+  if (curr->key != 20) {
+    cout << "Second element is " << curr->key << " while it should be 20\n";
+    ret = -1;
+  }
+  curr = list.get_next(curr);
+  if (curr->key != 25) {
+    cout << "Third element is " << curr->key << " while it should be 25\n";
+    ret = -1;
+  }
+
+  return ret;
+}
+
+/**
+ * @brief Number of operations to be performed by each worker
+ */
+const int NUM_OPERATIONS = 1000;
+
+/**
+ * @brief Worker function to insert elements into the list
+ *
+ * @param list LazyList object
+ * @param start Start index for the worker
+ * @param end End index for the worker
+ */
+void insert_worker(LazyList<int> &list, int start, int end) {
+  for (int i = start; i < end; ++i) {
+    list.insert(i);
+  }
+}
+
+/**
+ * @brief Worker function to remove elements from the list with exponential
+ * backoff
+ *
+ * @note Yielding wouldn't work here because we'd just be yielding to a
+ * different thread that's also spinning
+ * @param list LazyList object
+ * @param start Start index for the worker
+ * @param end End index for the worker
+ */
+void remove_worker(LazyList<int> &list, int start, int end) {
+  for (int i = start; i < end; ++i) {
+    // retry many times if needed b/c not sure if mutex maintains bounded wait
+    for (int attempt = 0; attempt < 10; ++attempt) {
+      if (list.remove(i))
+        break;
+      this_thread::sleep_for(chrono::milliseconds(1 << attempt));
+    }
+  }
+}
+
+/**
+ * @brief Worker function to insert and remove elements from the list
+ *
+ * We insert even numbers and try to remove odd numbers. This is to test that
+ * remove() calls that don't actually remove anything don't cause any issues.
+ *
+ * @param list LazyList object
+ * @param id Thread ID
+ */
+void mixed_worker_no_delete(LazyList<int> &list, int id) {
+  for (int i = 0; i < NUM_OPERATIONS; ++i) {
+    if (i % 2 == 0) {
+      list.insert(i + id * NUM_OPERATIONS);
+    } else {
+      for (int attempt = 0; attempt < 2; ++attempt) {
+        if (list.remove(i))
+          break;
+        this_thread::sleep_for(chrono::milliseconds(1 << attempt));
+      }
+    }
+  }
+}
+
+/**
+ * @brief Worker function to insert and remove elements from the list
+ *
+ * We insert even numbers and each thread tries to remove them. This is to test
+ * that remove() calls that actually remove something don't cause any issues. We
+ * check that the list is empty at the end.
+ *
+ * @param list LazyList object
+ * @param thread_id Thread ID
+ */
+void mixed_worker_all_delete(LazyList<int> &list, int thread_id) {
+  int base = thread_id * NUM_OPERATIONS;
+  for (int i = 0; i < NUM_OPERATIONS; ++i) {
+    if (i % 2 == 0) {
+      list.insert(base + i);
+    } else {
+      for (int attempt = 0; attempt < 5; ++attempt) {
+        if (list.remove(base + i - 1))
+          break;
+        this_thread::sleep_for(chrono::milliseconds(1 << attempt));
+      }
+    }
+  }
+}
+
+/**
+ * @brief Helper function to check that all the elements are in the list
+ * are reomved (can't be found).
+ *
+ * @param list LazyList object
+ * @return true If the list contains all the elements, false otherwise
+ */
+bool check_separate_workers(LazyList<int> &list) {
+  for (int i = 0; i < NUM_OPERATIONS; ++i) {
+    if (list.find(i)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief Helper function to check that the list contains the expected elements
+ * (even numbers) after mixed operations without actual deletions. We also check
+ * that the length of the list is as expected.
+ *
+ * @param list LazyList object
+ * @param num_threads Number of threads
+ * @return true If the list contains the expected elements, false otherwise
+ */
+bool check_mixed_worker_no_delete(LazyList<int> &list, int num_threads) {
+  LazyNode<int> *curr = list.get_front();
+  for (int i = 0; i < NUM_OPERATIONS * num_threads; i += 2) {
+    // even number should be in the list
+    if (curr->key != i) {
+      cout << "Expected " << i << " but got " << curr->key << endl;
+      return false;
+    }
+    // odd numbers should be deleted
+    if (list.find(i + 1)) {
+      cout << "Expected " << i << " to be deleted but it's still in the list\n";
+      return false;
+    }
+    curr = list.get_next(curr);
+  }
+
+  // make sure the list is not longer than expected
+  if (curr != list.get_tail()) {
+    cout << "List is longer than expected\n";
+    return false;
+  }
+
+  return true;
+}
+
+/**
+ * @brief Main test function for mixed operations
+ *
+ * This test creates multiple threads that insert and remove elements from the
+ * list. The test checks that the list contains the expected elements after all
+ * the operations.
+ *
+ * @return int 0 if the test passes, -1 otherwise
+ */
+int test_mixed() {
+  int ret = 0;
+
+  LazyList<int> list;
+
+  int num_threads = 16;
+  vector<thread> separate_work_threads;
+  vector<thread> mixed_work_threads;
+
+  cout << "---------- Testing separate but concurrent operations ----------\n";
+  for (int i = 0; i < num_threads; ++i) {
+    separate_work_threads.push_back(thread(insert_worker, ref(list),
+                                           i * NUM_OPERATIONS,
+                                           (i + 1) * NUM_OPERATIONS));
+  }
+
+  for (int i = 0; i < num_threads; ++i) {
+    separate_work_threads.push_back(thread(remove_worker, ref(list),
+                                           i * NUM_OPERATIONS,
+                                           (i + 1) * NUM_OPERATIONS));
+  }
+
+  for (auto &t : separate_work_threads) {
+    t.join();
+  }
+
+  cout << "State of the list after insertion and removal:\n";
+  list.print_list();
+  if (!check_separate_workers(list)) {
+    cout << "Separate operations failed\n";
+    ret = -1;
+  } else {
+    cout << "Separate operations passed\n";
+  }
+
+  cout << "---------- Testing mixed operations without actual deletions "
+          "----------\n";
+  for (int i = 0; i < num_threads; ++i) {
+    mixed_work_threads.push_back(thread(mixed_worker_no_delete, ref(list), i));
+  }
+
+  for (auto &t : mixed_work_threads) {
+    t.join();
+  }
+
+#ifdef DEBUG
+  cout
+      << "State of the list after mixed operations without actual deletions:\n";
+  list.print_list();
+#endif
+  if (!check_mixed_worker_no_delete(list, num_threads)) {
+    cout << "Mixed operations without actual deletions failed\n";
+    ret = -1;
+  } else {
+    cout << "Mixed operations without actual deletions passed\n";
+  }
+
+  cout << "---------- Testing mixed operations with all deletions ----------\n";
+  mixed_work_threads.clear();
+  for (int i = 0; i < num_threads; ++i) {
+    mixed_work_threads.push_back(thread(mixed_worker_all_delete, ref(list), i));
+  }
+  for (auto &t : mixed_work_threads) {
+    t.join();
+  }
+  cout << "State of the list after mixed operations with all deletions:\n";
+  list.print_list();
+  // check that the list is empty
+  if (list.get_front() != list.get_tail()) {
+    cout << "Mixed operations with all deletions failed\n";
+    ret = -1;
+  } else {
+    cout << "Mixed operations with all deletions passed\n";
+  }
+
+  return ret;
+}
+
+/**
+ * @brief Number of keys the threads of the contention test fight over
+ */
+const int HOT_KEYS = 16;
+
+/**
+ * @brief Worker function that inserts and removes a few hot keys, and counts
+ * how many times its inserts and removes of each key succeeded. With so few
+ * keys, the nodes a thread locks keep changing under it, and validate() fails
+ *
+ * @param list LazyList object
+ * @param seed Random seed of the worker
+ * @param net Inserts minus removes that succeeded, per key
+ */
+template <typename ListType>
+void hot_key_worker(ListType &list, int seed, vector<long> &net) {
+  FastRandom rng(seed);
+  for (int i = 0; i < 20 * NUM_OPERATIONS; ++i) {
+    int key = static_cast<int>(rng.next() % HOT_KEYS);
+    switch (rng.next() % 3) {
+    case 0:
+      net[key] += list.insert(key);
+      break;
+    case 1:
+      net[key] -= list.remove(key);
+      break;
+    default:
+      list.find(key);
+    }
+  }
+}
+
+/**
+ * @brief Test that the results of contended operations on the same keys are
+ * consistent: for every key, the inserts that succeeded minus the removes that
+ * succeeded is 1 if the key ends up in the list and 0 otherwise
+ *
+ * @return int 0 if the test passes, -1 otherwise
+ */
+template <typename ListType> int test_hot_keys() {
+  ListType list;
+  int num_threads = 8;
+  vector<vector<long>> net(num_threads, vector<long>(HOT_KEYS, 0));
+
+  vector<thread> threads;
+  for (int i = 0; i < num_threads; ++i) {
+    threads.push_back(
+        thread(hot_key_worker<ListType>, ref(list), i + 1, ref(net[i])));
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+
+  size_t present = 0;
+  for (int key = 0; key < HOT_KEYS; ++key) {
+    long total = 0;
+    for (int i = 0; i < num_threads; ++i) {
+      total += net[i][key];
+    }
+    bool found = list.find(key);
+    present += found;
+    if (total != (found ? 1 : 0)) {
+      cout << "Key " << key << " was inserted " << total
+           << " more times than removed, but is "
+           << (found ? "in" : "not in") << " the list\n";
+      return -1;
+    }
+  }
+  if (list.size() != present) {
+    cout << "List has " << list.size() << " keys instead of " << present
+         << "\n";
+    return -1;
+  }
+  return 0;
+}
+
+/**
+ * @brief Number of times the neighbours are removed and inserted again
+ */
+const int NEIGHBOUR_ROUNDS = 20;
+
+/**
+ * @brief Worker function that removes one key of every pair of neighbours.
+ * Keys 3m and 3m + 1 are adjacent, and are removed by threads id and id + 4
+ * in the same iteration, so each remove locks the node the other one unlinks.
+ * The keys are inserted back between rounds, and stay removed after the last
+ *
+ * @param list LazyList object
+ * @param id Thread ID, in [0, 8)
+ * @param num_keys Number of keys in the list, a multiple of 12
+ * @param failures Incremented when a key that is in the list isn't removed
+ */
+void neighbour_remove_worker(LazyList<int> &list, int id, int num_keys,
+                             atomic<int> &failures) {
+  for (int round = 0; round < NEIGHBOUR_ROUNDS; ++round) {
+    for (int m = id % 4; 3 * m < num_keys; m += 4) {
+      if (!list.remove(3 * m + id / 4))
+        failures++;
+    }
+    if (round == NEIGHBOUR_ROUNDS - 1)
+      break;
+    for (int m = id % 4; 3 * m < num_keys; m += 4) {
+      if (!list.insert(3 * m + id / 4))
+        failures++;
+    }
+  }
+}
+
+/**
+ * @brief Worker function that looks up the keys that are never removed, 3m +
+ * 2, while their predecessors are unlinked around them
+ *
+ * @param list LazyList object
+ * @param num_keys Number of keys in the list
+ * @param failures Incremented when one of the keys is missing
+ */
+void neighbour_reader_worker(LazyList<int> &list, int num_keys,
+                             atomic<int> &failures) {
+  for (int round = 0; round < NEIGHBOUR_ROUNDS; ++round) {
+    for (int key = 2; key < num_keys; key += 3) {
+      if (!list.find(key))
+        failures++;
+    }
+  }
+}
+
+/**
+ * @brief Test concurrent removes of adjacent nodes, with lookups of the nodes
+ * after them. Only the keys 3m + 2 should be left
+ *
+ * @return int 0 if the test passes, -1 otherwise
+ */
+int test_adjacent_removes() {
+  LazyList<int> list;
+  int num_keys = 3 * NUM_OPERATIONS;
+  for (int key = 0; key < num_keys; ++key) {
+    list.insert(key);
+  }
+
+  atomic<int> failures{0};
+  vector<thread> threads;
+  for (int i = 0; i < 8; ++i) {
+    threads.push_back(thread(neighbour_remove_worker, ref(list), i, num_keys,
+                             ref(failures)));
+  }
+  for (int i = 0; i < 2; ++i) {
+    threads.push_back(
+        thread(neighbour_reader_worker, ref(list), num_keys, ref(failures)));
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+  if (failures != 0) {
+    cout << failures << " removes or lookups failed\n";
+    return -1;
+  }
+
+  LazyNode<int> *curr = list.get_front();
+  for (int key = 2; key < num_keys; key += 3) {
+    if (curr == list.get_tail() || curr->key != key) {
+      cout << "Expected " << key << " in the list\n";
+      return -1;
+    }
+    curr = list.get_next(curr);
+  }
+  if (curr != list.get_tail() ||
+      list.size() != static_cast<size_t>(num_keys / 3)) {
+    cout << "List is longer than expected\n";
+    return -1;
+  }
+  return 0;
+}
+
+/**
+ * @brief Entry point. Run the tests and print the results.
+ *
+ * @return int 0 if program finishes
+ */
+int main() {
+  bool success = true;
+
+  cout << "======================= Testing sequential operations "
+          "=======================\n";
+  if (test_sequential() != 0) {
+    cout << "Test sequential failed\n";
+    success = false;
+  }
+  if (success) {
+    cout << "Sequential test passed\n";
+  }
+
+  cout << "======================= Testing mixed operations "
+          "=======================\n";
+  if (test_mixed() != 0) {
+    cout << "Test mixed failed\n";
+    success = false;
+  }
+  if (success) {
+    cout << "Mixed test passed\n";
+  }
+
+  cout << "======================= Testing hot keys "
+          "=======================\n";
+  if (test_hot_keys<LazyList<int>>() != 0 ||
+      test_hot_keys<LazyList<int, NodePool>>() != 0) {
+    cout << "Test hot keys failed\n";
+    success = false;
+  }
+  if (success) {
+    cout << "Hot key test passed\n";
+  }
+
+  cout << "======================= Testing adjacent removes "
+          "=======================\n";
+  if (test_adjacent_removes() != 0) {
+    cout << "Test adjacent removes failed\n";
+    success = false;
+  }
+  if (success) {
+    cout << "Adjacent remove test passed\n";
+  }
+
+  if (success) {
+    cout << "All tests passed\n";
+  }
+  return 0;
+}
\ No newline at end of file
@@ -1,4 +1,9 @@
+#include "key_distribution.h"
 #include "lock_free_list.h"
+#include "lock_free_list_no_reclaim.h"
+#include <algorithm>
+#include <limits>
+#include <random>
 
 /**
  * @brief A simpler test case for the lock-free list where operations are done
@@ -334,11 +339,841 @@ int test_reclaim() {
   return 0;
 }
 
+/**
+ * @brief Worker function for the thread churn test. It retires nodes, one of
+ * them still protected, and exits without clearing its hazard pointers
+ *
+ * @param manager Hazard pointer manager shared by the workers
+ */
+void churn_worker(HazardPointer<LockFreeNode<int>> &manager) {
+  vector<LockFreeNode<int> *> nodes;
+  for (int i = 0; i < 60; ++i) {
+    nodes.push_back(HeapAllocator<LockFreeNode<int>>::new_node(i));
+  }
+  manager.protect(nodes[0], 0);
+  for (auto node : nodes) {
+    manager.retire_node(node);
+  }
+}
+
+/**
+ * @brief Test that the hazard pointer records of exited threads are reused,
+ * and that the nodes they retired are freed by the threads after them
+ *
+ * @return int 0 if the test passes, -1 otherwise
+ */
+int test_thread_churn() {
+  const int num_waves = 100;
+  const int num_threads = 8;
+  auto live_nodes = []() {
+    return AllocationStats::allocated().read() -
+           AllocationStats::freed().read();
+  };
+  long before = live_nodes();
+  {
+    HazardPointer<LockFreeNode<int>> manager;
+    for (int wave = 0; wave < num_waves; ++wave) {
+      vector<thread> threads;
+      for (int i = 0; i < num_threads; ++i) {
+        threads.push_back(thread(churn_worker, ref(manager)));
+      }
+      for (auto &t : threads) {
+        t.join();
+      }
+    }
+    if (manager.num_records() > num_threads) {
+      cout << num_waves * num_threads << " threads left "
+           << manager.num_records() << " records\n";
+      return -1;
+    }
+    // only the last wave's nodes may be left
+    if (live_nodes() - before > num_threads * 60) {
+      cout << live_nodes() - before << " retired nodes were never freed\n";
+      return -1;
+    }
+  }
+  if (live_nodes() != before) {
+    cout << live_nodes() - before << " nodes leaked by the manager\n";
+    return -1;
+  }
+
+  // short-lived threads using a list, more of them than there used to be
+  // records
+  LockFreeList<int> list;
+  for (int wave = 0; wave < num_waves; ++wave) {
+    vector<thread> threads;
+    for (int i = 0; i < num_threads; ++i) {
+      threads.push_back(thread(
+          [&list, num_threads](int key) {
+            // the previous wave's keys are all in the list
+            list.insert(key);
+            list.remove(key - num_threads);
+          },
+          wave * num_threads + i));
+    }
+    for (auto &t : threads) {
+      t.join();
+    }
+  }
+  if (list.size() != num_threads ||
+      !list.find(num_waves * num_threads - 1)) {
+    cout << "List has " << list.size() << " keys instead of " << num_threads
+         << "\n";
+    return -1;
+  }
+  return 0;
+}
+
+/**
+ * @brief Worker function for the epoch thread churn test. It retires nodes in
+ * critical sections of their own, so the epoch keeps advancing
+ *
+ * @param manager Epoch reclaimer shared by the threads
+ */
+void epoch_churn_worker(EpochReclaimer<LockFreeNode<int>> &manager) {
+  for (int i = 0; i < 200; ++i) {
+    EpochReclaimer<LockFreeNode<int>>::Guard guard(manager);
+    manager.retire_node(HeapAllocator<LockFreeNode<int>>::new_node(i));
+  }
+}
+
+/**
+ * @brief Test that the epoch records of exited threads are reused, and that
+ * the limbo lists they leave behind are freed by the threads after them
+ *
+ * @return int 0 if the test passes, -1 otherwise
+ */
+int test_epoch_thread_churn() {
+  const int num_waves = 100;
+  const int num_threads = 8;
+  auto live_nodes = []() {
+    return AllocationStats::allocated().read() -
+           AllocationStats::freed().read();
+  };
+  long before = live_nodes();
+  {
+    EpochReclaimer<LockFreeNode<int>> manager;
+    for (int wave = 0; wave < num_waves; ++wave) {
+      vector<thread> threads;
+      for (int i = 0; i < num_threads; ++i) {
+        threads.push_back(thread(epoch_churn_worker, ref(manager)));
+      }
+      for (auto &t : threads) {
+        t.join();
+      }
+    }
+    if (manager.num_records() > num_threads) {
+      cout << num_waves * num_threads << " threads left "
+           << manager.num_records() << " epoch records\n";
+      return -1;
+    }
+    // the orphans of a wave are freed once the next waves advance the epoch
+    if (live_nodes() - before > 2 * num_threads * 200) {
+      cout << live_nodes() - before << " retired nodes were never freed\n";
+      return -1;
+    }
+  }
+  if (live_nodes() != before) {
+    cout << live_nodes() - before << " nodes leaked by the epoch reclaimer\n";
+    return -1;
+  }
+  return 0;
+}
+
+/**
+ * @brief Worker function for the epoch-based reclamation test. Every key the
+ * worker inserts is looked up and removed again
+ *
+ * @param list LockFreeList object using EpochReclaimer
+ * @param thread_id Thread ID
+ */
+void epoch_worker(LockFreeList<int, EpochReclaimer> &list, int thread_id) {
+  int base = thread_id * NUM_OPERATIONS;
+  for (int i = 0; i < NUM_OPERATIONS; ++i) {
+    list.insert(base + i);
+    list.find(base + i);
+    list.remove(base + i);
+  }
+}
+
+/**
+ * @brief Test the list with epoch-based reclamation instead of hazard pointers
+ *
+ * @return int 0 if the test passes, -1 otherwise
+ */
+int test_epoch_reclaim() {
+  LockFreeList<int, EpochReclaimer> list;
+
+  int num_threads = 8;
+  vector<thread> threads;
+  for (int i = 0; i < num_threads; ++i) {
+    threads.push_back(thread(epoch_worker, ref(list), i));
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+
+  // check that the list is empty
+  if (list.get_front() != list.get_tail()) {
+    cout << "List is not empty after all the removals\n";
+    return -1;
+  }
+  return 0;
+}
+
+/**
+ * @brief Worker function that keeps inserting and removing the odd keys
+ *
+ * @param list LockFreeList object
+ * @param done Set once the readers are finished
+ */
+template <typename ListType>
+void odd_churn_worker(ListType &list, atomic<bool> &done) {
+  while (!done) {
+    for (int i = 1; i < NUM_OPERATIONS; i += 2) {
+      list.insert(i);
+    }
+    for (int i = 1; i < NUM_OPERATIONS; i += 2) {
+      list.remove(i);
+    }
+  }
+}
+
+/**
+ * @brief Worker function that looks up the even keys, which are never removed
+ *
+ * @param list LockFreeList object
+ * @param failures Incremented when an even key isn't found
+ */
+template <typename ListType>
+void even_reader_worker(ListType &list, atomic<int> &failures) {
+  for (int round = 0; round < 20; ++round) {
+    for (int i = 0; i < NUM_OPERATIONS; i += 2) {
+      if (!list.contains(i))
+        failures++;
+    }
+  }
+}
+
+/**
+ * @brief Test that the read-only lookup finds every key that stays in the
+ * list while the nodes around it are marked and unlinked
+ *
+ * @return int 0 if the test passes, -1 otherwise
+ */
+template <typename ListType> int test_contains() {
+  ListType list;
+  for (int i = 0; i < NUM_OPERATIONS; i += 2) {
+    list.insert(i);
+  }
+
+  atomic<bool> done{false};
+  atomic<int> failures{0};
+  vector<thread> writers, readers;
+  for (int i = 0; i < 4; ++i) {
+    writers.push_back(thread(odd_churn_worker<ListType>, ref(list), ref(done)));
+    readers.push_back(
+        thread(even_reader_worker<ListType>, ref(list), ref(failures)));
+  }
+  for (auto &t : readers) {
+    t.join();
+  }
+  done = true;
+  for (auto &t : writers) {
+    t.join();
+  }
+
+  if (failures != 0) {
+    cout << failures << " lookups missed a key that was never removed\n";
+    return -1;
+  }
+  return 0;
+}
+
+/**
+ * @brief Worker function that inserts and removes its keys in sorted batches.
+ * The keys of the threads are interleaved so that the batches run into each
+ * other's nodes
+ *
+ * @param list LockFreeList object
+ * @param thread_id Thread ID
+ * @param num_threads Number of threads
+ * @param failures Incremented when a batch doesn't apply every key
+ */
+template <typename ListType>
+void batch_worker(ListType &list, int thread_id, int num_threads,
+                  atomic<int> &failures) {
+  vector<int> keys, odd_keys;
+  for (int i = 0; i < NUM_OPERATIONS; ++i) {
+    keys.push_back(i * num_threads + thread_id);
+    if (i % 2 == 1)
+      odd_keys.push_back(keys.back());
+  }
+  if (list.insert_batch(keys.begin(), keys.end()) != keys.size())
+    failures++;
+  // inserting again changes nothing
+  if (list.insert_batch(keys.begin(), keys.end()) != 0)
+    failures++;
+  if (list.remove_batch(odd_keys.begin(), odd_keys.end()) != odd_keys.size())
+    failures++;
+}
+
+/**
+ * @brief Test concurrent batch inserts and removes. Only the keys at even
+ * positions should be left
+ *
+ * @return int 0 if the test passes, -1 otherwise
+ */
+template <typename ListType> int test_batch() {
+  ListType list;
+  int num_threads = 8;
+  atomic<int> failures{0};
+
+  vector<thread> threads;
+  for (int i = 0; i < num_threads; ++i) {
+    threads.push_back(thread(batch_worker<ListType>, ref(list), i,
+                             num_threads, ref(failures)));
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+  if (failures != 0) {
+    cout << failures << " batches didn't apply every key\n";
+    return -1;
+  }
+
+  for (int key = 0; key < NUM_OPERATIONS * num_threads; ++key) {
+    bool expected = (key / num_threads) % 2 == 0;
+    if (list.find(key) != expected) {
+      cout << "Key " << key << " should" << (expected ? "" : " not")
+           << " be in the list\n";
+      return -1;
+    }
+  }
+
+  // the approximate size is off by less than a step for every thread
+  size_t size = num_threads * (NUM_OPERATIONS - NUM_OPERATIONS / 2);
+  size_t error = num_threads * ShardedCounter::APPROXIMATE_STEP;
+  if (list.size() != size) {
+    cout << "List size is " << list.size() << " instead of " << size << "\n";
+    return -1;
+  }
+  if (list.approximate_size() + error <= size ||
+      list.approximate_size() >= size + error) {
+    cout << "Approximate list size " << list.approximate_size()
+         << " is too far from " << size << "\n";
+    return -1;
+  }
+  return 0;
+}
+
+/**
+ * @brief Test that batches whose keys aren't sorted still insert and remove
+ * every key, and leave the list sorted
+ *
+ * @return int 0 if the test passes, -1 otherwise
+ */
+template <typename ListType> int test_unsorted_batch() {
+  ListType list;
+  vector<int> keys = {5, 1, 9, 3, 7, 3};
+  vector<int> removed = {9, 1, 7, 1};
+
+  if (list.insert_batch(keys.begin(), keys.end()) != 5) {
+    cout << "Unsorted batch didn't insert every key once\n";
+    return -1;
+  }
+  for (int key : keys) {
+    if (!list.find(key)) {
+      cout << "Key " << key << " of the unsorted batch can't be found\n";
+      return -1;
+    }
+  }
+  if (list.remove_batch(removed.begin(), removed.end()) != 3) {
+    cout << "Unsorted batch didn't remove every key once\n";
+    return -1;
+  }
+  vector<int> left;
+  list.range_query(0, 10, left);
+  if (left != vector<int>({3, 5}) || list.size() != 2) {
+    cout << "List should contain 3, 5\n";
+    return -1;
+  }
+  return 0;
+}
+
+/**
+ * @brief Worker function that scans a range of keys while the odd keys churn
+ *
+ * @param list LockFreeList object
+ * @param failures Incremented when a scan is out of order or misses an even
+ * key
+ */
+template <typename ListType>
+void range_reader_worker(ListType &list, atomic<int> &failures) {
+  const int lo = 10, hi = NUM_OPERATIONS - 10;
+  for (int round = 0; round < 20; ++round) {
+    vector<int> keys;
+    list.range_query(lo, hi, keys);
+    int expected_even = lo;
+    for (size_t i = 0; i < keys.size(); ++i) {
+      if (keys[i] < lo || keys[i] > hi || (i > 0 && keys[i] <= keys[i - 1])) {
+        failures++;
+        break;
+      }
+      if (keys[i] % 2 == 0) {
+        if (keys[i] != expected_even) {
+          failures++;
+          break;
+        }
+        expected_even += 2;
+      }
+    }
+    if (expected_even != hi + 2)
+      failures++;
+  }
+}
+
+/**
+ * @brief Test that range scans are sorted, stay in the range, and report every
+ * key that's in the list for the whole scan
+ *
+ * @return int 0 if the test passes, -1 otherwise
+ */
+template <typename ListType> int test_range_query() {
+  ListType list;
+  for (int i = 0; i < NUM_OPERATIONS; i += 2) {
+    list.insert(i);
+  }
+
+  atomic<bool> done{false};
+  atomic<int> failures{0};
+  vector<thread> writers, readers;
+  for (int i = 0; i < 4; ++i) {
+    writers.push_back(thread(odd_churn_worker<ListType>, ref(list), ref(done)));
+    readers.push_back(
+        thread(range_reader_worker<ListType>, ref(list), ref(failures)));
+  }
+  for (auto &t : readers) {
+    t.join();
+  }
+  done = true;
+  for (auto &t : writers) {
+    t.join();
+  }
+
+  if (failures != 0) {
+    cout << failures << " range scans were wrong\n";
+    return -1;
+  }
+  return 0;
+}
+
+/**
+ * @brief Test loading a shuffled range of keys with duplicates, split between
+ * several threads, and using the list afterwards
+ *
+ * @return int 0 if the test passes, -1 otherwise
+ */
+template <typename ListType> int test_bulk_load() {
+  const int num_keys = 100000;
+  vector<int> keys;
+  for (int i = 0; i < num_keys; ++i) {
+    keys.push_back(2 * i);
+    if (i % 10 == 0)
+      keys.push_back(2 * i);
+  }
+  shuffle(keys.begin(), keys.end(), minstd_rand(1));
+
+  ListType list;
+  if (list.bulk_load(keys.begin(), keys.end(), 4) != num_keys ||
+      list.size() != num_keys) {
+    cout << "Bulk load didn't load every key once\n";
+    return -1;
+  }
+  int expected = 0;
+  for (auto node = list.get_front(); node != list.get_tail();
+       node = get_unmarked_reference(node->next.load())) {
+    if (node->key != expected) {
+      cout << "Found " << node->key << " instead of " << expected << "\n";
+      return -1;
+    }
+    expected += 2;
+  }
+  if (expected != 2 * num_keys) {
+    cout << "Bulk loaded list ends at " << expected << "\n";
+    return -1;
+  }
+
+  // the loaded nodes are ordinary nodes, removing them frees them as usual
+  if (!list.insert(1) || list.insert(2) || !list.remove(0) ||
+      list.find(0) || !list.find(1) || list.size() != num_keys) {
+    cout << "Operations after the bulk load failed\n";
+    return -1;
+  }
+
+  bool thrown = false;
+  try {
+    list.bulk_load(keys.begin(), keys.end());
+  } catch (const runtime_error &) {
+    thrown = true;
+  }
+  if (!thrown) {
+    cout << "Bulk load into a list that isn't empty should throw\n";
+    return -1;
+  }
+  return 0;
+}
+
+/**
+ * @brief Worker function that runs clustered operations on two lists with the
+ * finger enabled: short ascending runs of keys from random places. The other
+ * list takes over the thread's finger every now and then
+ *
+ * @param list List whose keys are checked
+ * @param other Second list of the same type
+ * @param thread_id Seed of the keys
+ * @param balance Keys inserted minus keys removed from list
+ */
+template <typename ListType>
+void finger_worker(ListType &list, ListType &other, int thread_id,
+                   atomic<int> &balance) {
+  minstd_rand rng(thread_id + 1);
+  for (int run = 0; run < 2000; ++run) {
+    int base = rng() % 1024;
+    for (int key = base; key < base + 16; ++key) {
+      switch (rng() % 3) {
+      case 0:
+        if (list.insert(key))
+          balance++;
+        break;
+      case 1:
+        if (list.remove(key))
+          balance--;
+        break;
+      default:
+        list.find(key);
+      }
+    }
+    if (run % 8 == 0) {
+      other.insert(base);
+      other.remove(base + 1);
+    }
+  }
+}
+
+/**
+ * @brief Test that operations starting from the finger agree with the ones
+ * starting from the head, while keys around the fingers keep being removed
+ *
+ * @return int 0 if the test passes, -1 otherwise
+ */
+template <typename ListType> int test_finger() {
+  ListType list, other;
+  list.enable_finger(true);
+  other.enable_finger(true);
+
+  // ascending and then descending keys in a single thread
+  for (int key = 0; key < NUM_OPERATIONS; ++key) {
+    if (!list.insert(key) || !list.find(key)) {
+      cout << "Key " << key << " should be in the list\n";
+      return -1;
+    }
+  }
+  for (int key = NUM_OPERATIONS - 1; key >= 0; key -= 2) {
+    if (!list.remove(key) || list.find(key)) {
+      cout << "Key " << key << " should have been removed\n";
+      return -1;
+    }
+  }
+  atomic<int> balance{static_cast<int>(list.size())};
+
+  vector<thread> threads;
+  for (int i = 0; i < 8; ++i) {
+    threads.push_back(thread(finger_worker<ListType>, ref(list), ref(other),
+                             i, ref(balance)));
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+
+  list.enable_finger(false);
+  int count = 0;
+  for (int key = 0; key < 1024 + 16; ++key) {
+    if (list.find(key))
+      count++;
+  }
+  if (count != balance || list.size() != static_cast<size_t>(count)) {
+    cout << "List has " << count << " keys and a size of " << list.size()
+         << " but " << balance << " were inserted and not removed\n";
+    return -1;
+  }
+  return 0;
+}
+
 /**
  * @brief Entry point. Run the tests and print the results.
  * 
  * @return int 0 if program finishes
  */
+/**
+ * @brief Worker function for the hot key test. It runs a random mix of
+ * operations on keys drawn from a skewed distribution, and counts how many
+ * times each of its inserts and removes succeeded
+ *
+ * @param list List all the workers share
+ * @param keys Distribution of the keys
+ * @param thread_id Seed of the keys
+ * @param balance Per key, inserts minus removes that succeeded
+ */
+template <typename ListType>
+void hot_key_worker(ListType &list, const KeySpace &keys, int thread_id,
+                    vector<int> &balance) {
+  KeyGenerator generator(keys, thread_id + 1);
+  for (int i = 0; i < 20000; ++i) {
+    uint64_t choice = generator.next_random() % 3;
+    int key = static_cast<int>(generator.next(choice != 0));
+    if (choice == 0) {
+      list.find(key);
+    } else if (choice == 1) {
+      if (list.insert(key))
+        balance[key]++;
+    } else if (list.remove(key)) {
+      balance[key]--;
+    }
+  }
+}
+
+/**
+ * @brief Test that the list stays consistent while all the threads insert and
+ * remove the same few keys, which makes them fail their CASes on the same
+ * nodes all the time
+ *
+ * @return int 0 if the test passes, -1 otherwise
+ */
+template <typename ListType> int test_hot_keys(KeyDistribution distribution) {
+  const int num_threads = 8;
+  const long key_range = 256;
+  KeySpace keys(distribution, key_range);
+  ListType list;
+  vector<vector<int>> balances(num_threads, vector<int>(key_range));
+
+  vector<thread> threads;
+  for (int i = 0; i < num_threads; ++i) {
+    threads.push_back(thread(hot_key_worker<ListType>, ref(list), cref(keys),
+                             i, ref(balances[i])));
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+
+  size_t count = 0;
+  for (int key = 0; key < key_range; ++key) {
+    int balance = 0;
+    for (const auto &thread_balance : balances) {
+      balance += thread_balance[key];
+    }
+    if (balance != (list.find(key) ? 1 : 0)) {
+      cout << "Key " << key << " was inserted " << balance
+           << " more times than removed, but find says "
+           << list.find(key) << "\n";
+      return -1;
+    }
+    count += balance;
+  }
+  if (list.size() != count) {
+    cout << "List has " << count << " keys but a size of " << list.size()
+         << "\n";
+    return -1;
+  }
+  return 0;
+}
+
+/**
+ * @brief Test that the keys the sentinels hold, 0 for other key types and the
+ * smallest and largest values for arithmetic ones, are ordinary keys
+ *
+ * @return int 0 if the test passes, -1 otherwise
+ */
+template <typename ListType, typename KeyType> int test_extreme_keys() {
+  ListType list;
+  vector<KeyType> keys = {numeric_limits<KeyType>::lowest(), KeyType{},
+                          KeyType{1}, numeric_limits<KeyType>::max()};
+  if (numeric_limits<KeyType>::has_infinity) {
+    keys.insert(keys.begin(), -numeric_limits<KeyType>::infinity());
+    keys.push_back(numeric_limits<KeyType>::infinity());
+  }
+  keys.erase(unique(keys.begin(), keys.end()), keys.end());
+
+  for (const KeyType &key : keys) {
+    if (list.find(key) || list.remove(key)) {
+      cout << "Key " << key << " was found in an empty list\n";
+      return -1;
+    }
+  }
+  for (const KeyType &key : keys) {
+    if (!list.insert(key) || list.insert(key) || !list.find(key)) {
+      cout << "Key " << key << " should have been inserted once\n";
+      return -1;
+    }
+  }
+  vector<KeyType> out;
+  list.range_query(keys.front(), keys.back(), out);
+  if (out != keys || list.size() != keys.size()) {
+    cout << "Range query returned " << out.size() << " keys instead of "
+         << keys.size() << "\n";
+    return -1;
+  }
+  for (const KeyType &key : keys) {
+    if (!list.remove(key) || list.find(key)) {
+      cout << "Key " << key << " should have been removed\n";
+      return -1;
+    }
+  }
+  return 0;
+}
+
+/**
+ * @brief Worker function inserting the keys [start, end) in order
+ */
+template <typename ListType>
+void insert_range_worker(ListType &list, int start, int end) {
+  for (int key = start; key < end; ++key) {
+    list.insert(key);
+  }
+}
+
+/**
+ * @brief Worker function for the pop_min test. It pops keys until the list
+ * is empty and the producers are done
+ *
+ * @param list List the keys are popped from
+ * @param spray_width 1 to pop the smallest key, more to use
+ * pop_min_relaxed()
+ * @param producers_done Whether no more keys will be inserted
+ * @param popped Keys popped by the worker, in order
+ */
+template <typename ListType>
+void pop_worker(ListType &list, unsigned spray_width,
+                atomic<bool> &producers_done, vector<int> &popped) {
+  while (true) {
+    // read before popping, so that an empty list means no more keys are
+    // coming
+    bool done = producers_done.load();
+    int key;
+    bool found = spray_width == 1 ? list.pop_min(key)
+                                  : list.pop_min_relaxed(key, spray_width);
+    if (found) {
+      popped.push_back(key);
+    } else if (done) {
+      return;
+    }
+  }
+}
+
+/**
+ * @brief Check that the keys popped by the workers are 0 to num_keys - 1,
+ * each popped exactly once
+ */
+bool check_popped(const vector<vector<int>> &popped, int num_keys) {
+  vector<int> all;
+  for (const auto &keys : popped) {
+    all.insert(all.end(), keys.begin(), keys.end());
+  }
+  sort(all.begin(), all.end());
+  for (int i = 0; i < num_keys; ++i) {
+    if (i >= static_cast<int>(all.size()) || all[i] != i) {
+      cout << "Key " << i << " was not popped exactly once\n";
+      return false;
+    }
+  }
+  if (all.size() != static_cast<size_t>(num_keys)) {
+    cout << all.size() << " keys popped instead of " << num_keys << "\n";
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief Test the priority queue operations: keys come out smallest first,
+ * and every key is popped exactly once by concurrent poppers, with or without
+ * a spray and with keys being inserted at the same time
+ *
+ * @return int 0 if the test passes, -1 otherwise
+ */
+template <typename ListType> int test_pop_min() {
+  const int num_keys = 20000;
+  const int num_threads = 8;
+  ListType list;
+  int key;
+
+  vector<int> keys(1000);
+  for (int i = 0; i < 1000; ++i) {
+    keys[i] = i;
+  }
+  shuffle(keys.begin(), keys.end(), minstd_rand(1));
+  for (int k : keys) {
+    list.insert(k);
+  }
+  for (int i = 0; i < 1000; ++i) {
+    if (!list.peek_min(key) || key != i || !list.pop_min(key) || key != i) {
+      cout << "Expected to pop " << i << "\n";
+      return -1;
+    }
+  }
+  if (list.peek_min(key) || list.pop_min(key) ||
+      list.pop_min_relaxed(key, 8)) {
+    cout << "Popped a key from an empty list\n";
+    return -1;
+  }
+
+  for (unsigned spray_width : {1u, 2u * num_threads}) {
+    // with everything inserted first, and with producers running alongside
+    for (bool prefill : {true, false}) {
+      atomic<bool> producers_done{prefill};
+      vector<vector<int>> popped(num_threads);
+      vector<thread> threads;
+      if (prefill) {
+        for (int k = 0; k < num_keys; ++k) {
+          list.insert(k);
+        }
+      } else {
+        for (int i = 0; i < num_threads / 2; ++i) {
+          threads.push_back(thread(insert_range_worker<ListType>, ref(list),
+                                   i * num_keys / (num_threads / 2),
+                                   (i + 1) * num_keys / (num_threads / 2)));
+        }
+      }
+      vector<thread> poppers;
+      for (int i = 0; i < num_threads; ++i) {
+        poppers.push_back(thread(pop_worker<ListType>, ref(list), spray_width,
+                                 ref(producers_done), ref(popped[i])));
+      }
+      for (auto &t : threads) {
+        t.join();
+      }
+      producers_done = true;
+      for (auto &t : poppers) {
+        t.join();
+      }
+
+      if (!check_popped(popped, num_keys) || list.size() != 0) {
+        return -1;
+      }
+      // nothing is inserted while popping the smallest keys, so every
+      // worker sees them in increasing order
+      if (prefill && spray_width == 1) {
+        for (const auto &worker_keys : popped) {
+          if (!is_sorted(worker_keys.begin(), worker_keys.end())) {
+            cout << "Keys were not popped in increasing order\n";
+            return -1;
+          }
+        }
+      }
+    }
+  }
+  return 0;
+}
+
 int main() {
   bool success = true;
 
@@ -357,6 +1192,16 @@ int main() {
   test_reclaim();
   cout << "Reclaim test passed\n";
 
+  cout << "======================= Testing thread churn "
+          "=======================\n";
+  if (test_thread_churn() != 0 || test_epoch_thread_churn() != 0) {
+    cout << "Test thread churn failed\n";
+    success = false;
+  }
+  if (success) {
+    cout << "Thread churn test passed\n";
+  }
+
   cout << "======================= Testing mixed operations "
           "=======================\n";
   if (test_mixed() != 0) {
@@ -367,6 +1212,122 @@ int main() {
     cout << "Mixed test passed\n";
   }
 
+  cout << "======================= Testing epoch-based reclamation "
+          "=======================\n";
+  if (test_epoch_reclaim() != 0) {
+    cout << "Test epoch-based reclamation failed\n";
+    success = false;
+  }
+  if (success) {
+    cout << "Epoch-based reclamation test passed\n";
+  }
+
+  cout << "======================= Testing read-only lookups "
+          "=======================\n";
+  if (test_contains<LockFreeList<int>>() != 0 ||
+      test_contains<LockFreeList<int, PaddedHazardPointer>>() != 0 ||
+      test_contains<LockFreeList<int, EpochReclaimer>>() != 0) {
+    cout << "Test read-only lookups failed\n";
+    success = false;
+  }
+  if (success) {
+    cout << "Read-only lookup test passed\n";
+  }
+
+  cout << "======================= Testing batch operations "
+          "=======================\n";
+  if (test_batch<LockFreeList<int>>() != 0 ||
+      test_batch<LockFreeList<int, EpochReclaimer>>() != 0 ||
+      test_batch<LockFreeList<int, HazardPointer, HeapAllocator,
+                              SeqCstOrdering, ExponentialBackoff>>() != 0 ||
+      test_batch<LockFreeList<int, EpochReclaimer, HeapAllocator,
+                              SeqCstOrdering, RandomizedBackoff>>() != 0 ||
+      test_unsorted_batch<LockFreeList<int>>() != 0 ||
+      test_unsorted_batch<LockFreeList<int, EpochReclaimer>>() != 0 ||
+      test_unsorted_batch<LockFreeListNoReclaim<int>>() != 0) {
+    cout << "Test batch operations failed\n";
+    success = false;
+  }
+  if (success) {
+    cout << "Batch test passed\n";
+  }
+
+  cout << "======================= Testing range queries "
+          "=======================\n";
+  if (test_range_query<LockFreeList<int>>() != 0 ||
+      test_range_query<LockFreeList<int, EpochReclaimer>>() != 0) {
+    cout << "Test range queries failed\n";
+    success = false;
+  }
+  if (success) {
+    cout << "Range query test passed\n";
+  }
+
+  cout << "======================= Testing bulk load "
+          "=======================\n";
+  if (test_bulk_load<LockFreeList<int>>() != 0 ||
+      test_bulk_load<LockFreeList<int, EpochReclaimer, NodePool>>() != 0 ||
+      test_bulk_load<LockFreeListNoReclaim<int>>() != 0) {
+    cout << "Test bulk load failed\n";
+    success = false;
+  }
+  if (success) {
+    cout << "Bulk load test passed\n";
+  }
+
+  cout << "======================= Testing search fingers "
+          "=======================\n";
+  if (test_finger<LockFreeList<int>>() != 0 ||
+      test_finger<LockFreeList<int, EpochReclaimer>>() != 0 ||
+      test_finger<LockFreeListNoReclaim<int>>() != 0) {
+    cout << "Test search fingers failed\n";
+    success = false;
+  }
+  if (success) {
+    cout << "Search finger test passed\n";
+  }
+
+  cout << "======================= Testing extreme keys "
+          "=======================\n";
+  if (test_extreme_keys<LockFreeList<int>, int>() != 0 ||
+      test_extreme_keys<LockFreeList<unsigned, EpochReclaimer>, unsigned>() !=
+          0 ||
+      test_extreme_keys<LockFreeList<double>, double>() != 0 ||
+      test_extreme_keys<LockFreeListNoReclaim<long>, long>() != 0 ||
+      test_extreme_keys<LockFreeListNoReclaim<double>, double>() != 0) {
+    cout << "Test extreme keys failed\n";
+    success = false;
+  }
+  if (success) {
+    cout << "Extreme key test passed\n";
+  }
+
+  cout << "======================= Testing pop_min "
+          "=======================\n";
+  if (test_pop_min<LockFreeList<int>>() != 0 ||
+      test_pop_min<LockFreeList<int, EpochReclaimer, NodePool>>() != 0) {
+    cout << "Test pop_min failed\n";
+    success = false;
+  }
+  if (success) {
+    cout << "Pop min test passed\n";
+  }
+
+  cout << "======================= Testing hot keys "
+          "=======================\n";
+  for (KeyDistribution distribution : {KEYS_ZIPFIAN, KEYS_HOTSPOT}) {
+    if (test_hot_keys<LockFreeList<int>>(distribution) != 0 ||
+        test_hot_keys<LockFreeList<int, EpochReclaimer, NodePool>>(
+            distribution) != 0 ||
+        test_hot_keys<LockFreeListNoReclaim<int>>(distribution) != 0) {
+      cout << "Test hot keys failed\n";
+      success = false;
+    }
+  }
+  if (success) {
+    cout << "Hot key test passed\n";
+  }
+
   if (success) {
     cout << "All tests passed\n";
   }
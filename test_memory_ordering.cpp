@@ -0,0 +1,252 @@
+#include "lock_free_list.h"
+#include "lock_free_list_no_reclaim.h"
+#include <random>
+#include <vector>
+
+/* the lists with the weakest orderings, see memory_ordering.h */
+typedef LockFreeList<int, HazardPointer, HeapAllocator, AcquireReleaseOrdering>
+    HazardList;
+typedef LockFreeList<int, EpochReclaimer, HeapAllocator,
+                     AcquireReleaseOrdering>
+    EpochList;
+typedef LockFreeListNoReclaim<int, HeapAllocator, AcquireReleaseOrdering>
+    NoReclaimList;
+
+/**
+ * @brief Number of keys written by the writer of each litmus test
+ */
+const int NUM_KEYS = 20000;
+/**
+ * @brief Keys that the publication writers insert and remove
+ */
+const int KEY_RANGE = 1024;
+
+/**
+ * @brief Message passing: the writer inserts a key and then publishes it, and
+ * removes the previous key and then publishes that. A reader that sees a key
+ * published must see the update to the list that came before it.
+ *
+ * @param list List under test
+ * @param latest Last key inserted
+ * @param removing Key being removed, published before its removal
+ * @param removed Last key removed
+ */
+template <typename ListType>
+void message_writer(ListType &list, atomic<int> &latest,
+                    atomic<int> &removing, atomic<int> &removed) {
+  for (int key = 1; key <= NUM_KEYS; ++key) {
+    list.insert(key);
+    latest.store(key, memory_order_release);
+    removing.store(key - 1, memory_order_release);
+    list.remove(key - 1);
+    removed.store(key - 1, memory_order_release);
+  }
+}
+
+template <typename ListType>
+void message_reader(ListType &list, atomic<int> &latest,
+                    atomic<int> &removing, atomic<int> &removed,
+                    atomic<int> &failures) {
+  int key = 0;
+  while (key < NUM_KEYS) {
+    // keys are never inserted again once removed
+    int gone = removed.load(memory_order_acquire);
+    if (gone >= 0 && list.find(gone)) {
+      failures++;
+    }
+    key = latest.load(memory_order_acquire);
+    if (!list.find(key) && removing.load(memory_order_acquire) < key) {
+      failures++;
+    }
+  }
+}
+
+/**
+ * @brief Run the message passing test with one writer and a few readers
+ *
+ * @return int 0 if the test passes, -1 otherwise
+ */
+template <typename ListType> int test_message_passing() {
+  ListType list;
+  list.insert(0);
+  atomic<int> latest{0}, removing{-1}, removed{-1}, failures{0};
+
+  vector<thread> threads;
+  threads.push_back(thread(message_writer<ListType>, ref(list), ref(latest),
+                           ref(removing), ref(removed)));
+  for (int i = 0; i < 3; ++i) {
+    threads.push_back(thread(message_reader<ListType>, ref(list), ref(latest),
+                             ref(removing), ref(removed), ref(failures)));
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+  if (failures != 0) {
+    cout << failures << " lookups missed an update that was published\n";
+    return -1;
+  }
+  return 0;
+}
+
+/**
+ * @brief Publication: writers link fresh nodes while readers walk the list
+ * and read their keys. A reader must never see a node before its key.
+ */
+template <typename ListType>
+void publication_writer(ListType &list, int thread_id) {
+  minstd_rand rng(thread_id + 1);
+  for (int i = 0; i < NUM_KEYS; ++i) {
+    int key = 1 + rng() % KEY_RANGE;
+    if (rng() % 2 == 0) {
+      list.insert(key);
+    } else {
+      list.remove(key);
+    }
+  }
+}
+
+template <typename ListType>
+void publication_reader(ListType &list, atomic<bool> &done,
+                        atomic<int> &failures) {
+  while (!done) {
+    int last = 0;
+    list.for_each_in_range(1, KEY_RANGE, [&](const int &key) {
+      // keys are nonzero and visited in ascending order
+      if (key <= last || key > KEY_RANGE) {
+        failures++;
+      }
+      last = key;
+    });
+  }
+}
+
+/**
+ * @brief Run the publication test with writers and readers on the same keys
+ *
+ * @return int 0 if the test passes, -1 otherwise
+ */
+template <typename ListType> int test_publication() {
+  ListType list;
+  atomic<bool> done{false};
+  atomic<int> failures{0};
+
+  vector<thread> writers, readers;
+  for (int i = 0; i < 4; ++i) {
+    writers.push_back(thread(publication_writer<ListType>, ref(list), i));
+  }
+  for (int i = 0; i < 2; ++i) {
+    readers.push_back(thread(publication_reader<ListType>, ref(list),
+                             ref(done), ref(failures)));
+  }
+  for (auto &t : writers) {
+    t.join();
+  }
+  done = true;
+  for (auto &t : readers) {
+    t.join();
+  }
+  if (failures != 0) {
+    cout << failures << " keys were read out of order or uninitialized\n";
+    return -1;
+  }
+  return 0;
+}
+
+/**
+ * @brief Reclamation handshake: threads keep removing and inserting a few
+ * keys so that nodes are retired and freed all the time, while readers look
+ * them up. A node freed while a reader still uses it shows up as a wrong
+ * result, or as an error under AddressSanitizer.
+ */
+template <typename ListType>
+void churn_worker(ListType &list, int thread_id, atomic<int> &balance) {
+  minstd_rand rng(thread_id + 1);
+  for (int i = 0; i < NUM_KEYS; ++i) {
+    int key = rng() % 64;
+    if (rng() % 2 == 0) {
+      if (list.insert(key))
+        balance++;
+    } else {
+      if (list.remove(key))
+        balance--;
+    }
+    list.find(rng() % 64);
+  }
+}
+
+/**
+ * @brief Run the reclamation test
+ *
+ * @return int 0 if the test passes, -1 otherwise
+ */
+template <typename ListType> int test_reclamation() {
+  ListType list;
+  atomic<int> balance{0};
+
+  vector<thread> threads;
+  for (int i = 0; i < 8; ++i) {
+    threads.push_back(
+        thread(churn_worker<ListType>, ref(list), i, ref(balance)));
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+
+  int count = 0;
+  for (int key = 0; key < 64; ++key) {
+    if (list.find(key))
+      count++;
+  }
+  if (count != balance || list.size() != static_cast<size_t>(count)) {
+    cout << "List has " << count << " keys and a size of " << list.size()
+         << " but " << balance << " were inserted and not removed\n";
+    return -1;
+  }
+  return 0;
+}
+
+/**
+ * @brief Entry point. Run the tests and print the results.
+ *
+ * @return int 0 if program finishes
+ */
+int main() {
+  bool success = true;
+
+  cout << "======================= Testing message passing "
+          "=======================\n";
+  if (test_message_passing<HazardList>() != 0 ||
+      test_message_passing<EpochList>() != 0 ||
+      test_message_passing<NoReclaimList>() != 0) {
+    cout << "Test message passing failed\n";
+    success = false;
+  } else {
+    cout << "Message passing test passed\n";
+  }
+
+  cout << "======================= Testing publication "
+          "=======================\n";
+  if (test_publication<HazardList>() != 0 ||
+      test_publication<EpochList>() != 0 ||
+      test_publication<NoReclaimList>() != 0) {
+    cout << "Test publication failed\n";
+    success = false;
+  } else {
+    cout << "Publication test passed\n";
+  }
+
+  cout << "======================= Testing reclamation "
+          "=======================\n";
+  if (test_reclamation<HazardList>() != 0 ||
+      test_reclamation<EpochList>() != 0) {
+    cout << "Test reclamation failed\n";
+    success = false;
+  } else {
+    cout << "Reclamation test passed\n";
+  }
+
+  if (success) {
+    cout << "All tests passed\n";
+  }
+  return 0;
+}
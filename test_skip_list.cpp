@@ -0,0 +1,199 @@
+#include "lock_free_skip_list.h"
+#include <vector>
+
+/**
+ * @brief A simple test case for the skip list where operations are done
+ * sequentially. After all the operations, the list should contain 5, 20, 25.
+ *
+ * @return int 0 if the test passes, -1 otherwise
+ */
+int test_sequential() {
+  int ret = 0;
+  LockFreeSkipList<int> list;
+
+  list.insert(10);
+  list.insert(20);
+  list.insert(15);
+
+  list.remove(15);
+
+  list.insert(25);
+  list.insert(5);
+
+  list.remove(10);
+
+  list.print_list();
+  // list should contain 5, 20, 25
+  int expected[] = {5, 20, 25};
+  LockFreeSkipNode<int> *curr = list.get_front();
+  for (int key : expected) {
+    if (curr == list.get_tail() || curr->key != key) {
+      cout << "Missing element " << key << "\n";
+      return -1;
+    }
+    curr = list.get_next(curr);
+  }
+  if (curr != list.get_tail()) {
+    cout << "List has more than 3 elements\n";
+    ret = -1;
+  }
+  if (list.insert(20) || list.remove(15) || !list.find(25) || list.find(10)) {
+    cout << "Wrong result for an existing or missing key\n";
+    ret = -1;
+  }
+
+  return ret;
+}
+
+/**
+ * @brief Number of operations to be performed by each worker
+ */
+const int NUM_OPERATIONS = 2000;
+
+/**
+ * @brief Worker function that inserts its own keys, checks them and removes
+ * every other one
+ *
+ * @param list LockFreeSkipList object
+ * @param thread_id Thread ID
+ * @param failures Incremented when an operation gives the wrong result
+ */
+void private_keys_worker(LockFreeSkipList<int> &list, int thread_id,
+                         atomic<int> &failures) {
+  // interleave the keys of the threads so that they share the nodes around
+  // them
+  for (int i = 0; i < NUM_OPERATIONS; ++i) {
+    if (!list.insert(i * 16 + thread_id))
+      failures++;
+  }
+  for (int i = 0; i < NUM_OPERATIONS; ++i) {
+    if (!list.find(i * 16 + thread_id))
+      failures++;
+  }
+  for (int i = 0; i < NUM_OPERATIONS; i += 2) {
+    if (!list.remove(i * 16 + thread_id))
+      failures++;
+  }
+}
+
+/**
+ * @brief Worker function where all the threads insert and remove the same
+ * small set of keys
+ *
+ * @param list LockFreeSkipList object
+ * @param thread_id Thread ID, used as the random seed
+ * @param balance Number of successful inserts minus successful removes
+ */
+void shared_keys_worker(LockFreeSkipList<int> &list, int thread_id,
+                        atomic<int> &balance) {
+  minstd_rand rng(thread_id + 1);
+  for (int i = 0; i < NUM_OPERATIONS; ++i) {
+    int key = rng() % 64;
+    if (rng() % 2 == 0) {
+      if (list.insert(key))
+        balance++;
+    } else {
+      if (list.remove(key))
+        balance--;
+    }
+  }
+}
+
+/**
+ * @brief Test concurrent operations on disjoint and on contended keys
+ *
+ * @return int 0 if the test passes, -1 otherwise
+ */
+int test_concurrent() {
+  int ret = 0;
+  int num_threads = 8;
+
+  {
+    LockFreeSkipList<int> list;
+    atomic<int> failures{0};
+    vector<thread> threads;
+    for (int i = 0; i < num_threads; ++i) {
+      threads.push_back(
+          thread(private_keys_worker, ref(list), i, ref(failures)));
+    }
+    for (auto &t : threads) {
+      t.join();
+    }
+    if (failures != 0) {
+      cout << failures << " operations on private keys failed\n";
+      ret = -1;
+    }
+    // only the odd indices are left, in order
+    int count = 0, prev = -1;
+    for (auto curr = list.get_front(); curr != list.get_tail();
+         curr = list.get_next(curr)) {
+      if (curr->key <= prev || (curr->key / 16) % 2 == 0) {
+        cout << "Unexpected key " << curr->key << " after " << prev << "\n";
+        ret = -1;
+      }
+      prev = curr->key;
+      count++;
+    }
+    if (count != num_threads * NUM_OPERATIONS / 2) {
+      cout << "List has " << count << " keys instead of "
+           << num_threads * NUM_OPERATIONS / 2 << "\n";
+      ret = -1;
+    }
+  }
+
+  {
+    LockFreeSkipList<int> list;
+    atomic<int> balance{0};
+    vector<thread> threads;
+    for (int i = 0; i < num_threads; ++i) {
+      threads.push_back(thread(shared_keys_worker, ref(list), i, ref(balance)));
+    }
+    for (auto &t : threads) {
+      t.join();
+    }
+    int count = 0;
+    for (int key = 0; key < 64; ++key) {
+      if (list.find(key))
+        count++;
+    }
+    if (count != balance) {
+      cout << "List has " << count << " keys but " << balance
+           << " were inserted and not removed\n";
+      ret = -1;
+    }
+  }
+
+  return ret;
+}
+
+/**
+ * @brief Entry point. Run the tests and print the results.
+ *
+ * @return int 0 if program finishes
+ */
+int main() {
+  bool success = true;
+
+  cout << "======================= Testing sequential operations "
+          "=======================\n";
+  if (test_sequential() != 0) {
+    cout << "Test sequential failed\n";
+    success = false;
+  } else {
+    cout << "Sequential test passed\n";
+  }
+
+  cout << "======================= Testing concurrent operations "
+          "=======================\n";
+  if (test_concurrent() != 0) {
+    cout << "Test concurrent failed\n";
+    success = false;
+  } else {
+    cout << "Concurrent test passed\n";
+  }
+
+  if (success) {
+    cout << "All tests passed\n";
+  }
+  return 0;
+}
@@ -0,0 +1,136 @@
+#include "split_ordered_set.h"
+#include <random>
+#include <vector>
+
+/**
+ * @brief A simple test case for the hash set where operations are done
+ * sequentially, with enough keys for the bucket array to grow several times
+ *
+ * @return int 0 if the test passes, -1 otherwise
+ */
+int test_sequential() {
+  int ret = 0;
+  SplitOrderedSet<int> set;
+  const int num_keys = 10000;
+
+  for (int i = 0; i < num_keys; ++i) {
+    if (!set.insert(i)) {
+      cout << "Failed to insert " << i << "\n";
+      ret = -1;
+    }
+  }
+  if (set.insert(42)) {
+    cout << "Inserted 42 twice\n";
+    ret = -1;
+  }
+  for (int i = 0; i < num_keys; i += 2) {
+    if (!set.remove(i)) {
+      cout << "Failed to remove " << i << "\n";
+      ret = -1;
+    }
+  }
+  for (int i = 0; i < num_keys; ++i) {
+    if (set.find(i) != (i % 2 == 1)) {
+      cout << "Wrong result when looking up " << i << "\n";
+      ret = -1;
+    }
+  }
+  if (set.get_bucket_count() <= 2) {
+    cout << "Bucket array never grew\n";
+    ret = -1;
+  }
+
+  return ret;
+}
+
+/**
+ * @brief Number of operations to be performed by each worker
+ */
+const int NUM_OPERATIONS = 5000;
+
+/**
+ * @brief Worker function where all the threads insert and remove the same
+ * set of keys while the bucket array grows
+ *
+ * @param set SplitOrderedSet object
+ * @param thread_id Thread ID, used as the random seed
+ * @param balance Number of successful inserts minus successful removes
+ */
+void shared_keys_worker(SplitOrderedSet<int> &set, int thread_id,
+                        atomic<int> &balance) {
+  minstd_rand rng(thread_id + 1);
+  for (int i = 0; i < NUM_OPERATIONS; ++i) {
+    int key = rng() % 4096;
+    // insert more than we remove so that the set keeps growing
+    if (rng() % 3 != 0) {
+      if (set.insert(key))
+        balance++;
+    } else {
+      if (set.remove(key))
+        balance--;
+    }
+  }
+}
+
+/**
+ * @brief Test concurrent operations on contended keys
+ *
+ * @return int 0 if the test passes, -1 otherwise
+ */
+int test_concurrent() {
+  SplitOrderedSet<int> set;
+  atomic<int> balance{0};
+  int num_threads = 8;
+
+  vector<thread> threads;
+  for (int i = 0; i < num_threads; ++i) {
+    threads.push_back(thread(shared_keys_worker, ref(set), i, ref(balance)));
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+
+  int count = 0;
+  for (int key = 0; key < 4096; ++key) {
+    if (set.find(key))
+      count++;
+  }
+  if (count != balance) {
+    cout << "Set has " << count << " keys but " << balance
+         << " were inserted and not removed\n";
+    return -1;
+  }
+  return 0;
+}
+
+/**
+ * @brief Entry point. Run the tests and print the results.
+ *
+ * @return int 0 if program finishes
+ */
+int main() {
+  bool success = true;
+
+  cout << "======================= Testing sequential operations "
+          "=======================\n";
+  if (test_sequential() != 0) {
+    cout << "Test sequential failed\n";
+    success = false;
+  } else {
+    cout << "Sequential test passed\n";
+  }
+
+  cout << "======================= Testing concurrent operations "
+          "=======================\n";
+  if (test_concurrent() != 0) {
+    cout << "Test concurrent failed\n";
+    success = false;
+  } else {
+    cout << "Concurrent test passed\n";
+  }
+
+  if (success) {
+    cout << "All tests passed\n";
+  }
+  return 0;
+}
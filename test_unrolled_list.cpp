@@ -0,0 +1,264 @@
+#include "lock_free_unrolled_list.h"
+#include <limits>
+#include <random>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Count the keys and the blocks of the list, and check that the keys
+ * are sorted across blocks
+ * @note Not thread-safe
+ *
+ * @return int Number of keys, -1 if the list is out of order
+ */
+template <typename ListType> int count_keys(ListType &list, int &blocks) {
+  int count = 0;
+  bool first = true;
+  int last = 0;
+  blocks = 0;
+  for (auto node = list.get_front(); node != nullptr;
+       node = list.get_next(node)) {
+    blocks++;
+    for (int i = 0; i < node->count; ++i) {
+      if (!first && node->keys[i] <= last) {
+        return -1;
+      }
+      first = false;
+      last = node->keys[i];
+      count++;
+    }
+  }
+  return count;
+}
+
+/**
+ * @brief A simple test case for the unrolled list where operations are done
+ * sequentially, with enough keys for blocks to split and then to merge again
+ *
+ * @return int 0 if the test passes, -1 otherwise
+ */
+int test_sequential() {
+  int ret = 0;
+  LockFreeUnrolledList<int> list;
+  const int num_keys = 2000;
+  int blocks;
+
+  // descending, so that every insert goes to the front block
+  for (int i = num_keys - 1; i >= 0; --i) {
+    if (!list.insert(i)) {
+      cout << "Failed to insert " << i << "\n";
+      ret = -1;
+    }
+  }
+  if (list.insert(42)) {
+    cout << "Inserted 42 twice\n";
+    ret = -1;
+  }
+  if (count_keys(list, blocks) != num_keys) {
+    cout << "List is out of order or lost keys after inserts\n";
+    ret = -1;
+  }
+  int full_blocks = blocks;
+  if (full_blocks < num_keys / UnrolledNode<int>::CAPACITY) {
+    cout << "Blocks never split, " << full_blocks << " blocks\n";
+    ret = -1;
+  }
+
+  // leave one key in eight, so that the blocks fall under the minimum
+  for (int i = 0; i < num_keys; ++i) {
+    if (i % 8 != 0 && !list.remove(i)) {
+      cout << "Failed to remove " << i << "\n";
+      ret = -1;
+    }
+  }
+  if (list.remove(1)) {
+    cout << "Removed 1 twice\n";
+    ret = -1;
+  }
+  for (int i = 0; i < num_keys; ++i) {
+    if (list.find(i) != (i % 8 == 0)) {
+      cout << "Wrong result when looking up " << i << "\n";
+      ret = -1;
+    }
+  }
+  if (count_keys(list, blocks) != num_keys / 8) {
+    cout << "List is out of order or lost keys after removes\n";
+    ret = -1;
+  }
+  if (blocks >= full_blocks / 2) {
+    cout << "Blocks never merged, " << blocks << " blocks\n";
+    ret = -1;
+  }
+
+  for (int i = 0; i < num_keys; i += 8) {
+    list.remove(i);
+  }
+  if (list.get_front() != nullptr || list.find(0)) {
+    cout << "List is not empty\n";
+    ret = -1;
+  }
+
+  return ret;
+}
+
+/**
+ * @brief Number of operations to be performed by each worker
+ */
+const int NUM_OPERATIONS = 20000;
+const int KEY_RANGE = 2048;
+
+/**
+ * @brief Worker function where all the threads insert and remove the same
+ * range of keys, so that blocks split and merge under each other
+ *
+ * @param list LockFreeUnrolledList object
+ * @param thread_id Thread ID, used as the random seed
+ * @param balance Number of successful inserts minus successful removes
+ */
+void shared_keys_worker(LockFreeUnrolledList<int> &list, int thread_id,
+                        atomic<int> &balance) {
+  minstd_rand rng(thread_id + 1);
+  for (int i = 0; i < NUM_OPERATIONS; ++i) {
+    int key = rng() % KEY_RANGE;
+    int op = rng() % 3;
+    if (op == 0) {
+      if (list.insert(key))
+        balance++;
+    } else if (op == 1) {
+      if (list.remove(key))
+        balance--;
+    } else {
+      list.find(key);
+    }
+  }
+}
+
+/**
+ * @brief Test concurrent operations on contended keys
+ *
+ * @return int 0 if the test passes, -1 otherwise
+ */
+int test_concurrent() {
+  LockFreeUnrolledList<int> list;
+  atomic<int> balance{0};
+  int num_threads = 8;
+
+  vector<thread> threads;
+  for (int i = 0; i < num_threads; ++i) {
+    threads.push_back(thread(shared_keys_worker, ref(list), i, ref(balance)));
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+
+  int blocks;
+  int count = count_keys(list, blocks);
+  if (count != balance || list.size() != static_cast<size_t>(count)) {
+    cout << "List has " << count << " keys and a size of " << list.size()
+         << " but " << balance << " were inserted and not removed\n";
+    return -1;
+  }
+  for (int key = 0; key < KEY_RANGE; ++key) {
+    if (list.find(key))
+      count--;
+  }
+  if (count != 0) {
+    cout << "Lookups don't agree with the blocks\n";
+    return -1;
+  }
+  return 0;
+}
+
+/**
+ * @brief Test lookups in blocks of keys of another type, with the smallest and
+ * largest values of the type. Integral keys are searched with the vector
+ * scan, the others with a binary search
+ *
+ * @param half_range Number of keys on each side of zero, for signed keys
+ * @return int 0 if the test passes, -1 otherwise
+ */
+template <typename KeyType> int test_key_type(int half_range) {
+  LockFreeUnrolledList<KeyType> list;
+  int lo = is_signed_v<KeyType> ? -half_range : 0;
+  int hi = lo + 2 * half_range;
+  vector<KeyType> keys;
+  for (int i = lo; i < hi; ++i) {
+    keys.push_back(static_cast<KeyType>(i * 3));
+  }
+  keys.push_back(numeric_limits<KeyType>::lowest());
+  keys.push_back(numeric_limits<KeyType>::max());
+  shuffle(keys.begin(), keys.end(), mt19937(7));
+  for (KeyType key : keys) {
+    list.insert(key);
+  }
+
+  for (int round = 0; round < 2; ++round) {
+    for (int i = lo; i < hi; ++i) {
+      bool expected = round == 0 || i % 2 == 0;
+      if (list.find(static_cast<KeyType>(i * 3)) != expected ||
+          list.find(static_cast<KeyType>(i * 3 + 1))) {
+        cout << "Wrong result when looking up " << i * 3 << " or "
+             << i * 3 + 1 << "\n";
+        return -1;
+      }
+    }
+    if (!list.find(numeric_limits<KeyType>::lowest()) ||
+        !list.find(numeric_limits<KeyType>::max())) {
+      cout << "Can't find the smallest or the largest key\n";
+      return -1;
+    }
+    // the keys at odd positions are gone in the second round
+    for (int i = lo; i < hi; ++i) {
+      if (i % 2 != 0) {
+        list.remove(static_cast<KeyType>(i * 3));
+      }
+    }
+  }
+  return 0;
+}
+
+/**
+ * @brief Entry point. Run the tests and print the results.
+ *
+ * @return int 0 if program finishes
+ */
+int main() {
+  bool success = true;
+
+  cout << "======================= Testing sequential operations "
+          "=======================\n";
+  if (test_sequential() != 0) {
+    cout << "Test sequential failed\n";
+    success = false;
+  } else {
+    cout << "Sequential test passed\n";
+  }
+
+  cout << "======================= Testing concurrent operations "
+          "=======================\n";
+  if (test_concurrent() != 0) {
+    cout << "Test concurrent failed\n";
+    success = false;
+  } else {
+    cout << "Concurrent test passed\n";
+  }
+
+  cout << "======================= Testing key types "
+          "=======================\n";
+  if (test_key_type<signed char>(40) != 0 ||
+      test_key_type<unsigned char>(40) != 0 ||
+      test_key_type<short>(1000) != 0 || test_key_type<unsigned>(1000) != 0 ||
+      test_key_type<long>(1000) != 0 ||
+      test_key_type<unsigned long long>(1000) != 0 ||
+      test_key_type<double>(1000) != 0) {
+    cout << "Test key types failed\n";
+    success = false;
+  } else {
+    cout << "Key type test passed\n";
+  }
+
+  if (success) {
+    cout << "All tests passed\n";
+  }
+  return 0;
+}